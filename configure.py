@@ -81,12 +81,14 @@ class Configuration:
         self.writer.build(object_file, "cc", source_file, variables=variables)
         return object_file
 
-    def ccld(self, object_files, executable_file):
+    def ccld(self, object_files, executable_file, libs=None):
         if not os.path.isabs(executable_file):
             executable_file = os.path.join(self.artifact_dir, executable_file)
         variables = {
             "descpath": os.path.relpath(executable_file, self.artifact_dir)
         }
+        if libs:
+            variables["libs"] = " ".join("-l" + lib for lib in libs)
         self.writer.build(executable_file, "ccld", object_files, variables=variables)
         return executable_file
 
@@ -187,17 +189,34 @@ def main():
         config.cc("webserver/http.c"),
         config.cc("webserver/parse.c"),
     ]
+    statistics_object = config.cc("runner/statistics.c")
     runner_objects = [
         config.cc("runner/perfctr.c"),
-        config.cc("runner/median.c"),
+        config.cc("runner/planner.c"),
+        config.cc("runner/perfmon.c"),
+        config.cc("runner/sampling.c"),
+        config.cc("runner/tma.c"),
+        config.cc("runner/timing.c"),
+        config.cc("runner/disturbance.c"),
+        config.cc("runner/cache.c"),
+        config.cc("runner/roofline.c"),
+        config.cc("runner/frequency.c"),
+        config.cc("runner/fence.c"),
+        config.cc("runner/arguments.c"),
+        config.cc("runner/calibration.c"),
+        config.cc("runner/threads.c"),
+        statistics_object,
         config.cc("runner/sandbox.c"),
         config.cc("runner/loader.c"),
         config.cc("runner/spec.c"),
     ]
 
-    webrunner = config.ccld(webserver_objects + runner_objects + kernel_objects, "webrunner")
+    webrunner = config.ccld(webserver_objects + runner_objects + kernel_objects, "webrunner", libs=["m", "pthread"])
     config.default(webrunner)
 
+    statistics_bench = config.ccld([config.cc("bench/statistics.c"), statistics_object], "statistics-bench", libs=["m"])
+    config.phony("bench", [statistics_bench])
+
     webrunner_program = config.install(webrunner, "/usr/sbin/webrunner", mode="755")
     webrunner_service = config.install("webrunner.service", "/etc/systemd/system/webrunner.service")
     config.enable([webrunner_program, webrunner_service], "webrunner.service")
@@ -0,0 +1,99 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#include <runner/statistics.h>
+
+/*
+ * Microbenchmark for the sample statistics of the profiler: exact medians with sorting and with selection, and
+ * streaming tail quantile estimation with the P-square algorithm.
+ */
+
+#define REPETITIONS 5
+
+static const size_t sample_counts[] = { 1000, 10000, 100000, 1000000, 10000000 };
+
+static uint64_t random_state = UINT64_C(0x853C49E6748FEA9B);
+
+/* Synthetic cycle counts: a narrow peak with a long right tail, like a kernel which is sometimes interrupted */
+static unsigned long long generate_sample(void) {
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 7;
+	random_state ^= random_state << 17;
+	const double uniform = (double) (random_state >> 11) * 0x1.0p-53;
+	return 1000 + (unsigned long long) (-100.0 * log1p(-uniform)) + ((random_state & 1023) == 0 ? 50000 : 0);
+}
+
+static int compare_ulonglong(const void* a_ptr, const void* b_ptr) {
+	const unsigned long long a = *((const unsigned long long*) a_ptr);
+	const unsigned long long b = *((const unsigned long long*) b_ptr);
+	return (a > b) - (a < b);
+}
+
+static unsigned long long sort_median(unsigned long long array[restrict static 1], size_t length) {
+	qsort(array, length, sizeof(unsigned long long), compare_ulonglong);
+	return array[length / 2];
+}
+
+int main(void) {
+	const size_t max_count = sample_counts[sizeof(sample_counts) / sizeof(sample_counts[0]) - 1];
+	unsigned long long* samples = malloc(max_count * sizeof(unsigned long long));
+	unsigned long long* scratch = malloc(max_count * sizeof(unsigned long long));
+	if (samples == NULL || scratch == NULL) {
+		fprintf(stderr, "failed to allocate %zu samples\n", max_count);
+		return EXIT_FAILURE;
+	}
+	for (size_t i = 0; i < max_count; i++) {
+		samples[i] = generate_sample();
+	}
+
+	printf("%10s %14s %14s %14s %14s %14s\n", "samples", "qsort (ns/el)", "select (ns/el)",
+		"P2 (ns/el)", "p99 exact", "p99 P2");
+	for (size_t c = 0; c < sizeof(sample_counts) / sizeof(sample_counts[0]); c++) {
+		const size_t count = sample_counts[c];
+		uint64_t sort_time = UINT64_MAX, select_time = UINT64_MAX, p2_time = UINT64_MAX;
+		unsigned long long sort_result = 0, select_result = 0;
+		double p2_result = 0.0;
+		for (size_t repetition = 0; repetition < REPETITIONS; repetition++) {
+			memcpy(scratch, samples, count * sizeof(unsigned long long));
+			uint64_t start = get_monotonic_nanoseconds();
+			sort_result = sort_median(scratch, count);
+			uint64_t end = get_monotonic_nanoseconds();
+			sort_time = end - start < sort_time ? end - start : sort_time;
+
+			memcpy(scratch, samples, count * sizeof(unsigned long long));
+			start = get_monotonic_nanoseconds();
+			select_result = select_order_statistic(scratch, count, count / 2);
+			end = get_monotonic_nanoseconds();
+			select_time = end - start < select_time ? end - start : select_time;
+
+			struct p2_quantile estimator;
+			init_p2_quantile(&estimator, 0.99);
+			start = get_monotonic_nanoseconds();
+			for (size_t i = 0; i < count; i++) {
+				update_p2_quantile(&estimator, (double) samples[i]);
+			}
+			p2_result = get_p2_quantile(&estimator);
+			end = get_monotonic_nanoseconds();
+			p2_time = end - start < p2_time ? end - start : p2_time;
+		}
+		if (sort_result != select_result) {
+			fprintf(stderr, "median mismatch for %zu samples: %llu (qsort) vs %llu (select)\n",
+				count, sort_result, select_result);
+			return EXIT_FAILURE;
+		}
+
+		memcpy(scratch, samples, count * sizeof(unsigned long long));
+		const unsigned long long exact_p99 = select_order_statistic(scratch, count, count * 99 / 100);
+		printf("%10zu %14.2lf %14.2lf %14.2lf %14llu %14.0lf\n", count,
+			(double) sort_time / (double) count, (double) select_time / (double) count, (double) p2_time / (double) count,
+			exact_p99, p2_result);
+	}
+
+	free(samples);
+	free(scratch);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,192 @@
+#include <math.h>
+
+#include <kernels/blis/reference.h>
+
+float blis_sdot_reference(size_t n, const float* x, size_t incx, const float* y, size_t incy) {
+	float sum = 0.0f;
+	for (size_t i = 0; i < n; i++) {
+		sum += x[i * incx] * y[i * incy];
+	}
+	return sum;
+}
+
+double blis_ddot_reference(size_t n, const double* x, size_t incx, const double* y, size_t incy) {
+	double sum = 0.0;
+	for (size_t i = 0; i < n; i++) {
+		sum += x[i * incx] * y[i * incy];
+	}
+	return sum;
+}
+
+void blis_saxpy_reference(size_t n, float alpha, const float* x, size_t incx, float* y, size_t incy) {
+	for (size_t i = 0; i < n; i++) {
+		y[i * incy] += alpha * x[i * incx];
+	}
+}
+
+void blis_daxpy_reference(size_t n, double alpha, const double* x, size_t incx, double* y, size_t incy) {
+	for (size_t i = 0; i < n; i++) {
+		y[i * incy] += alpha * x[i * incx];
+	}
+}
+
+void blis_sscal_reference(size_t n, float alpha, float* x, size_t incx) {
+	for (size_t i = 0; i < n; i++) {
+		x[i * incx] *= alpha;
+	}
+}
+
+float blis_sasum_reference(size_t n, const float* x, size_t incx) {
+	float sum = 0.0f;
+	for (size_t i = 0; i < n; i++) {
+		sum += fabsf(x[i * incx]);
+	}
+	return sum;
+}
+
+float blis_snrm2_reference(size_t n, const float* x, size_t incx) {
+	/* Accumulate in double precision instead of scaling: float squares can not overflow a double */
+	double sum = 0.0;
+	for (size_t i = 0; i < n; i++) {
+		const double element = (double) x[i * incx];
+		sum += element * element;
+	}
+	return (float) sqrt(sum);
+}
+
+size_t blis_samax_reference(size_t n, const float* x, size_t incx) {
+	size_t index = 0;
+	float max = -1.0f;
+	for (size_t i = 0; i < n; i++) {
+		const float element = fabsf(x[i * incx]);
+		if (element > max) {
+			max = element;
+			index = i;
+		}
+	}
+	return index;
+}
+
+void blis_scopy_reference(size_t n, const float* x, size_t incx, float* y, size_t incy) {
+	for (size_t i = 0; i < n; i++) {
+		y[i * incy] = x[i * incx];
+	}
+}
+
+void blis_sgemv_n_reference(size_t m, size_t n, float alpha, const float* a, size_t rs_a, size_t cs_a,
+	const float* x, size_t incx, float beta, float* y, size_t incy)
+{
+	for (size_t i = 0; i < m; i++) {
+		float sum = 0.0f;
+		for (size_t j = 0; j < n; j++) {
+			sum += a[i * rs_a + j * cs_a] * x[j * incx];
+		}
+		y[i * incy] = beta * y[i * incy] + alpha * sum;
+	}
+}
+
+void blis_dgemv_n_reference(size_t m, size_t n, double alpha, const double* a, size_t rs_a, size_t cs_a,
+	const double* x, size_t incx, double beta, double* y, size_t incy)
+{
+	for (size_t i = 0; i < m; i++) {
+		double sum = 0.0;
+		for (size_t j = 0; j < n; j++) {
+			sum += a[i * rs_a + j * cs_a] * x[j * incx];
+		}
+		y[i * incy] = beta * y[i * incy] + alpha * sum;
+	}
+}
+
+void blis_sgemv_t_reference(size_t m, size_t n, float alpha, const float* a, size_t rs_a, size_t cs_a,
+	const float* x, size_t incx, float beta, float* y, size_t incy)
+{
+	for (size_t j = 0; j < n; j++) {
+		float sum = 0.0f;
+		for (size_t i = 0; i < m; i++) {
+			sum += a[i * rs_a + j * cs_a] * x[i * incx];
+		}
+		y[j * incy] = beta * y[j * incy] + alpha * sum;
+	}
+}
+
+void blis_dgemv_t_reference(size_t m, size_t n, double alpha, const double* a, size_t rs_a, size_t cs_a,
+	const double* x, size_t incx, double beta, double* y, size_t incy)
+{
+	for (size_t j = 0; j < n; j++) {
+		double sum = 0.0;
+		for (size_t i = 0; i < m; i++) {
+			sum += a[i * rs_a + j * cs_a] * x[i * incx];
+		}
+		y[j * incy] = beta * y[j * incy] + alpha * sum;
+	}
+}
+
+void blis_sgemm_reference(uint32_t mr, uint32_t nr, size_t k, const float* alpha, const float* a, const float* b,
+	const float* beta, float* c, size_t rs_c, size_t cs_c)
+{
+	for (size_t i = 0; i < mr; i++) {
+		for (size_t j = 0; j < nr; j++) {
+			float sum = 0.0f;
+			for (size_t p = 0; p < k; p++) {
+				sum += a[p * mr + i] * b[p * nr + j];
+			}
+			float* cij = &c[i * rs_c + j * cs_c];
+			*cij = *beta * *cij + *alpha * sum;
+		}
+	}
+}
+
+void blis_dgemm_reference(uint32_t mr, uint32_t nr, size_t k, const double* alpha, const double* a, const double* b,
+	const double* beta, double* c, size_t rs_c, size_t cs_c)
+{
+	for (size_t i = 0; i < mr; i++) {
+		for (size_t j = 0; j < nr; j++) {
+			double sum = 0.0;
+			for (size_t p = 0; p < k; p++) {
+				sum += a[p * mr + i] * b[p * nr + j];
+			}
+			double* cij = &c[i * rs_c + j * cs_c];
+			*cij = *beta * *cij + *alpha * sum;
+		}
+	}
+}
+
+void blis_cgemm_reference(uint32_t mr, uint32_t nr, size_t k, const float* alpha, const float* a, const float* b,
+	const float* beta, float* c, size_t rs_c, size_t cs_c)
+{
+	for (size_t i = 0; i < mr; i++) {
+		for (size_t j = 0; j < nr; j++) {
+			float sum_re = 0.0f, sum_im = 0.0f;
+			for (size_t p = 0; p < k; p++) {
+				const float* aip = &a[2 * (p * mr + i)];
+				const float* bpj = &b[2 * (p * nr + j)];
+				sum_re += aip[0] * bpj[0] - aip[1] * bpj[1];
+				sum_im += aip[0] * bpj[1] + aip[1] * bpj[0];
+			}
+			float* cij = &c[2 * (i * rs_c + j * cs_c)];
+			const float c_re = cij[0], c_im = cij[1];
+			cij[0] = beta[0] * c_re - beta[1] * c_im + alpha[0] * sum_re - alpha[1] * sum_im;
+			cij[1] = beta[0] * c_im + beta[1] * c_re + alpha[0] * sum_im + alpha[1] * sum_re;
+		}
+	}
+}
+
+void blis_zgemm_reference(uint32_t mr, uint32_t nr, size_t k, const double* alpha, const double* a, const double* b,
+	const double* beta, double* c, size_t rs_c, size_t cs_c)
+{
+	for (size_t i = 0; i < mr; i++) {
+		for (size_t j = 0; j < nr; j++) {
+			double sum_re = 0.0, sum_im = 0.0;
+			for (size_t p = 0; p < k; p++) {
+				const double* aip = &a[2 * (p * mr + i)];
+				const double* bpj = &b[2 * (p * nr + j)];
+				sum_re += aip[0] * bpj[0] - aip[1] * bpj[1];
+				sum_im += aip[0] * bpj[1] + aip[1] * bpj[0];
+			}
+			double* cij = &c[2 * (i * rs_c + j * cs_c)];
+			const double c_re = cij[0], c_im = cij[1];
+			cij[0] = beta[0] * c_re - beta[1] * c_im + alpha[0] * sum_re - alpha[1] * sum_im;
+			cij[1] = beta[0] * c_im + beta[1] * c_re + alpha[0] * sum_im + alpha[1] * sum_re;
+		}
+	}
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Plain C implementations of the BLIS kernel specs, compiled into the server as their references.
+ * Signatures match the <call> elements of the specs; vector increments and matrix strides are in elements.
+ */
+
+float blis_sdot_reference(size_t n, const float* x, size_t incx, const float* y, size_t incy);
+double blis_ddot_reference(size_t n, const double* x, size_t incx, const double* y, size_t incy);
+
+void blis_saxpy_reference(size_t n, float alpha, const float* x, size_t incx, float* y, size_t incy);
+void blis_daxpy_reference(size_t n, double alpha, const double* x, size_t incx, double* y, size_t incy);
+
+void blis_sscal_reference(size_t n, float alpha, float* x, size_t incx);
+float blis_sasum_reference(size_t n, const float* x, size_t incx);
+float blis_snrm2_reference(size_t n, const float* x, size_t incx);
+/** @brief Returns the index of the first element with the largest absolute value. */
+size_t blis_samax_reference(size_t n, const float* x, size_t incx);
+void blis_scopy_reference(size_t n, const float* x, size_t incx, float* y, size_t incy);
+
+/** @brief Computes y := beta * y + alpha * A x for an m x n matrix A. */
+void blis_sgemv_n_reference(size_t m, size_t n, float alpha, const float* a, size_t rs_a, size_t cs_a,
+	const float* x, size_t incx, float beta, float* y, size_t incy);
+void blis_dgemv_n_reference(size_t m, size_t n, double alpha, const double* a, size_t rs_a, size_t cs_a,
+	const double* x, size_t incx, double beta, double* y, size_t incy);
+
+/** @brief Computes y := beta * y + alpha * A^T x for an m x n matrix A. */
+void blis_sgemv_t_reference(size_t m, size_t n, float alpha, const float* a, size_t rs_a, size_t cs_a,
+	const float* x, size_t incx, float beta, float* y, size_t incy);
+void blis_dgemv_t_reference(size_t m, size_t n, double alpha, const double* a, size_t rs_a, size_t cs_a,
+	const double* x, size_t incx, double beta, double* y, size_t incy);
+
+/**
+ * @brief Computes C := beta * C + alpha * A B for packed micro-panels A (mr x k) and B (k x nr) and an mr x nr tile C.
+ * @details The tile size comes first, from the mr and nr parameters of the specs: the microkernels have it built in.
+ *          Complex variants take interleaved (real, imaginary) pairs, with rs_c and cs_c in complex elements.
+ */
+void blis_sgemm_reference(uint32_t mr, uint32_t nr, size_t k, const float* alpha, const float* a, const float* b,
+	const float* beta, float* c, size_t rs_c, size_t cs_c);
+void blis_dgemm_reference(uint32_t mr, uint32_t nr, size_t k, const double* alpha, const double* a, const double* b,
+	const double* beta, double* c, size_t rs_c, size_t cs_c);
+void blis_cgemm_reference(uint32_t mr, uint32_t nr, size_t k, const float* alpha, const float* a, const float* b,
+	const float* beta, float* c, size_t rs_c, size_t cs_c);
+void blis_zgemm_reference(uint32_t mr, uint32_t nr, size_t k, const double* alpha, const double* a, const double* b,
+	const double* beta, double* c, size_t rs_c, size_t cs_c);
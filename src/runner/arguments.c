@@ -0,0 +1,216 @@
+#include <string.h>
+#include <errno.h>
+
+#include <sys/mman.h>
+
+#include <webserver/logs.h>
+#include <runner/arguments.h>
+
+void* allocate_argument_arena(size_t size) {
+	if (size == 0) {
+		return NULL;
+	}
+	void* arena = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+	if (arena == MAP_FAILED) {
+		log_fatal("failed to allocate %zu bytes for kernel arguments: %s\n", size, strerror(errno));
+	}
+	return arena;
+}
+
+void free_argument_arena(void* arena, size_t size) {
+	if (arena != NULL) {
+		munmap(arena, size);
+	}
+}
+
+void fill_float_buffer(float buffer[restrict static 1], size_t count, float value) {
+	for (size_t i = 0; i < count; i++) {
+		buffer[i] = value;
+	}
+}
+
+void fill_double_buffer(double buffer[restrict static 1], size_t count, double value) {
+	for (size_t i = 0; i < count; i++) {
+		buffer[i] = value;
+	}
+}
+
+void fill_uint8_buffer(uint8_t buffer[restrict static 1], size_t count, uint8_t value) {
+	memset(buffer, value, count);
+}
+
+void fill_float_pattern_buffer(float buffer[restrict static 1], size_t count,
+	size_t pattern_size, const float pattern[restrict static pattern_size])
+{
+	for (size_t i = 0; i < count; i++) {
+		buffer[i] = pattern[i % pattern_size];
+	}
+}
+
+void fill_double_pattern_buffer(double buffer[restrict static 1], size_t count,
+	size_t pattern_size, const double pattern[restrict static pattern_size])
+{
+	for (size_t i = 0; i < count; i++) {
+		buffer[i] = pattern[i % pattern_size];
+	}
+}
+
+void fill_uint8_pattern_buffer(uint8_t buffer[restrict static 1], size_t count,
+	size_t pattern_size, const uint8_t pattern[restrict static pattern_size])
+{
+	for (size_t i = 0; i < count; i++) {
+		buffer[i] = pattern[i % pattern_size];
+	}
+}
+
+/*
+ * The generators below hash the element index instead of advancing a sequential state (SplitMix64 finalizer).
+ * Elements are independent, so the compiler vectorizes the loops, and the values do not depend on the stride.
+ */
+
+static inline uint64_t mix_bits(uint64_t z) {
+	z = (z ^ (z >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+	z = (z ^ (z >> 27)) * UINT64_C(0x94D049BB133111EB);
+	return z ^ (z >> 31);
+}
+
+static inline uint64_t hash_element(uint64_t key, size_t index) {
+	return mix_bits(key + (uint64_t) (index + 1) * UINT64_C(0x9E3779B97F4A7C15));
+}
+
+static inline float uint32_as_float(uint32_t bits) {
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+static inline double uint64_as_double(uint64_t bits) {
+	double value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+/* Maps the high bits of a hash to [-1, 1) through the mantissa of a number in [1, 2) */
+static inline float uniform_float(uint64_t bits) {
+	return uint32_as_float(UINT32_C(0x3F800000) | (uint32_t) (bits >> 41)) * 2.0f - 3.0f;
+}
+
+static inline double uniform_double(uint64_t bits) {
+	return uint64_as_double(UINT64_C(0x3FF0000000000000) | (bits >> 12)) * 2.0 - 3.0;
+}
+
+/* Irwin-Hall approximation: the sum of four 16-bit uniform variables, scaled to zero mean and unit variance */
+static inline double normal_double(uint64_t bits) {
+	const int32_t sum = (int32_t) ((bits & 0xFFFF) + ((bits >> 16) & 0xFFFF) + ((bits >> 32) & 0xFFFF) + (bits >> 48));
+	return ((double) sum * 0x1.0p-16 - 2.0) * 1.7320508075688772;
+}
+
+void fill_uniform_float_buffer(float buffer[restrict static 1], size_t count, uint64_t seed) {
+	const uint64_t key = mix_bits(seed);
+	for (size_t i = 0; i < count; i++) {
+		buffer[i] = uniform_float(hash_element(key, i));
+	}
+}
+
+void fill_uniform_double_buffer(double buffer[restrict static 1], size_t count, uint64_t seed) {
+	const uint64_t key = mix_bits(seed);
+	for (size_t i = 0; i < count; i++) {
+		buffer[i] = uniform_double(hash_element(key, i));
+	}
+}
+
+void fill_uniform_uint8_buffer(uint8_t buffer[restrict static 1], size_t count, uint64_t seed) {
+	const uint64_t key = mix_bits(seed);
+	for (size_t i = 0; i < count; i++) {
+		buffer[i] = (uint8_t) (hash_element(key, i) >> 56);
+	}
+}
+
+void fill_normal_float_buffer(float buffer[restrict static 1], size_t count, uint64_t seed) {
+	const uint64_t key = mix_bits(seed);
+	for (size_t i = 0; i < count; i++) {
+		buffer[i] = (float) normal_double(hash_element(key, i));
+	}
+}
+
+void fill_normal_double_buffer(double buffer[restrict static 1], size_t count, uint64_t seed) {
+	const uint64_t key = mix_bits(seed);
+	for (size_t i = 0; i < count; i++) {
+		buffer[i] = normal_double(hash_element(key, i));
+	}
+}
+
+/* Denormal numbers have a zero exponent field and a non-zero mantissa */
+void fill_denormal_float_buffer(float buffer[restrict static 1], size_t count, uint64_t seed) {
+	const uint64_t key = mix_bits(seed);
+	for (size_t i = 0; i < count; i++) {
+		const uint32_t bits = (uint32_t) (hash_element(key, i) >> 32);
+		buffer[i] = uint32_as_float((bits & UINT32_C(0x807FFFFF)) | 1);
+	}
+}
+
+void fill_denormal_double_buffer(double buffer[restrict static 1], size_t count, uint64_t seed) {
+	const uint64_t key = mix_bits(seed);
+	for (size_t i = 0; i < count; i++) {
+		const uint64_t bits = hash_element(key, i);
+		buffer[i] = uint64_as_double((bits & UINT64_C(0x800FFFFFFFFFFFFF)) | 1);
+	}
+}
+
+/* The low 32 bits of a hash decide whether an element is non-zero, the high bits give its value */
+static inline uint64_t get_density_threshold(double density) {
+	if (!(density > 0.0)) {
+		return 0;
+	} else if (density >= 1.0) {
+		return UINT64_C(0x100000000);
+	} else {
+		return (uint64_t) (density * 0x1.0p+32);
+	}
+}
+
+void fill_sparse_float_buffer(float buffer[restrict static 1], size_t count, uint64_t seed, double density) {
+	const uint64_t key = mix_bits(seed);
+	const uint64_t threshold = get_density_threshold(density);
+	for (size_t i = 0; i < count; i++) {
+		const uint64_t bits = hash_element(key, i);
+		buffer[i] = (bits & UINT64_C(0xFFFFFFFF)) < threshold ? uniform_float(bits) : 0.0f;
+	}
+}
+
+void fill_sparse_double_buffer(double buffer[restrict static 1], size_t count, uint64_t seed, double density) {
+	const uint64_t key = mix_bits(seed);
+	const uint64_t threshold = get_density_threshold(density);
+	for (size_t i = 0; i < count; i++) {
+		const uint64_t bits = hash_element(key, i);
+		buffer[i] = (bits & UINT64_C(0xFFFFFFFF)) < threshold ? uniform_double((bits >> 32) << 32) : 0.0;
+	}
+}
+
+void fill_sequence_float_buffer(float buffer[restrict static 1], size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		buffer[i] = (float) (int64_t) i;
+	}
+}
+
+void fill_sequence_double_buffer(double buffer[restrict static 1], size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		buffer[i] = (double) (int64_t) i;
+	}
+}
+
+void fill_sequence_uint8_buffer(uint8_t buffer[restrict static 1], size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		buffer[i] = (uint8_t) i;
+	}
+}
+
+void fill_string_uint8_buffer(uint8_t buffer[restrict static 1], size_t count, uint64_t seed) {
+	const uint64_t key = mix_bits(seed);
+	for (size_t i = 0; i < count; i++) {
+		/* Scale 32 random bits to [1, 255] */
+		buffer[i] = (uint8_t) (1 + (((hash_element(key, i) >> 32) * 255) >> 32));
+	}
+	if (count != 0) {
+		buffer[count - 1] = 0;
+	}
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Maximum alignment of an argument buffer: the arena mapping is only page-aligned */
+#define MAX_BUFFER_ALIGNMENT 4096
+
+/**
+ * @brief Rounds an offset within the argument arena up to a multiple of a power-of-two alignment.
+ */
+static inline size_t align_buffer_offset(size_t offset, size_t alignment) {
+	return (offset + alignment - 1) & -alignment;
+}
+
+/**
+ * @brief Maps one populated anonymous region for all buffers of a kernel call.
+ * @details Must be called before the sandbox is enabled, because the pages are populated at mapping time.
+ * @param[in] size Total size of the buffers, including alignment padding. May be 0.
+ * @return Pointer to the arena, or NULL if @a size is 0. Aborts if the mapping fails.
+ */
+void* allocate_argument_arena(size_t size);
+
+/**
+ * @brief Unmaps an arena allocated with allocate_argument_arena.
+ */
+void free_argument_arena(void* arena, size_t size);
+
+/**
+ * @brief Fills a buffer with a constant.
+ */
+void fill_float_buffer(float buffer[restrict static 1], size_t count, float value);
+void fill_double_buffer(double buffer[restrict static 1], size_t count, double value);
+void fill_uint8_buffer(uint8_t buffer[restrict static 1], size_t count, uint8_t value);
+
+/**
+ * @brief Fills a buffer with a sequence of constants, repeated as many times as the buffer fits.
+ * @details Used for interleaved complex scalars, e.g. 1 + 0i is the pattern {1.0, 0.0}.
+ */
+void fill_float_pattern_buffer(float buffer[restrict static 1], size_t count,
+	size_t pattern_size, const float pattern[restrict static pattern_size]);
+void fill_double_pattern_buffer(double buffer[restrict static 1], size_t count,
+	size_t pattern_size, const double pattern[restrict static pattern_size]);
+void fill_uint8_pattern_buffer(uint8_t buffer[restrict static 1], size_t count,
+	size_t pattern_size, const uint8_t pattern[restrict static pattern_size]);
+
+/**
+ * @brief Fills a buffer with reproducible pseudo-random values, uniformly distributed in [-1, 1).
+ * @param[in] seed Seed of the generator; the same seed gives the same values.
+ */
+void fill_uniform_float_buffer(float buffer[restrict static 1], size_t count, uint64_t seed);
+void fill_uniform_double_buffer(double buffer[restrict static 1], size_t count, uint64_t seed);
+void fill_uniform_uint8_buffer(uint8_t buffer[restrict static 1], size_t count, uint64_t seed);
+
+/**
+ * @brief Fills a buffer with reproducible pseudo-random values, approximately normally distributed.
+ * @details Values have zero mean and unit variance, and are bounded by +/-2*sqrt(3).
+ * @param[in] seed Seed of the generator; the same seed gives the same values.
+ */
+void fill_normal_float_buffer(float buffer[restrict static 1], size_t count, uint64_t seed);
+void fill_normal_double_buffer(double buffer[restrict static 1], size_t count, uint64_t seed);
+
+/**
+ * @brief Fills a buffer with reproducible pseudo-random non-zero denormal numbers of either sign.
+ * @param[in] seed Seed of the generator; the same seed gives the same values.
+ */
+void fill_denormal_float_buffer(float buffer[restrict static 1], size_t count, uint64_t seed);
+void fill_denormal_double_buffer(double buffer[restrict static 1], size_t count, uint64_t seed);
+
+/**
+ * @brief Fills a buffer with zeros, except for a random subset of elements uniformly distributed in [-1, 1).
+ * @param[in] seed    Seed of the generator; the same seed gives the same values.
+ * @param[in] density Probability that an element is non-zero.
+ */
+void fill_sparse_float_buffer(float buffer[restrict static 1], size_t count, uint64_t seed, double density);
+void fill_sparse_double_buffer(double buffer[restrict static 1], size_t count, uint64_t seed, double density);
+
+/**
+ * @brief Fills a buffer with the element indices: 0, 1, 2, ...
+ * @details Byte buffers hold the indices modulo 256.
+ */
+void fill_sequence_float_buffer(float buffer[restrict static 1], size_t count);
+void fill_sequence_double_buffer(double buffer[restrict static 1], size_t count);
+void fill_sequence_uint8_buffer(uint8_t buffer[restrict static 1], size_t count);
+
+/**
+ * @brief Fills a buffer with a null-terminated string of reproducible pseudo-random non-zero bytes.
+ * @details The string length is count - 1.
+ * @param[in] seed Seed of the generator; the same seed gives the same values.
+ */
+void fill_string_uint8_buffer(uint8_t buffer[restrict static 1], size_t count, uint64_t seed);
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <stdint.h>
+#include <stdbool.h>
 #include <limits.h>
 #include <cpuid.h>
 
@@ -7,61 +9,259 @@
 #include <linux/perf_event.h>
 
 #include <runner/perfctr.h>
+#include <runner/sampling.h>
+#include <runner/timing.h>
+#include <runner/statistics.h>
+#include <runner/disturbance.h>
+#include <runner/cache.h>
+#include <runner/frequency.h>
 
-#define DECLARE_PROFILE_FUNCTION(name) \
-	unsigned long long name##_profile(void* name, \
+/**
+ * @brief Reads the values of all counters in a group.
+ * @return true if the read succeeded, false otherwise.
+ */
+static inline bool read_performance_counter_group(const struct performance_counter_group group[restrict static 1],
+	struct performance_counter_group_values values[restrict static 1])
+{
+	const size_t read_size = (3 + group->count) * sizeof(uint64_t);
+	return read(group->file_descriptor, values, read_size) == read_size;
+}
+
+/**
+ * @brief Checks that the counters in a group were running during all the time between two reads, i.e. the kernel did
+ *        not multiplex them out.
+ */
+static inline bool is_performance_counter_group_sample_valid(
+	const struct performance_counter_group_values start_values[restrict static 1],
+	const struct performance_counter_group_values end_values[restrict static 1])
+{
+	return end_values->time_running - start_values->time_running == end_values->time_enabled - start_values->time_enabled;
+}
+
+/**
+ * @brief Returns zero which the processor can not compute until the floating-point result of a kernel call is ready.
+ * @details AND with an immediate zero is not a dependency-breaking idiom, so adding the returned value to the arguments
+ *          of the next call makes that call wait for the previous one.
+ */
+static inline uintptr_t get_float_result_dependency(float result) {
+	uint32_t bits;
+	__asm__ ("movd %1, %0\n\tandl $0, %0" : "=r" (bits) : "x" (result));
+	return bits;
+}
+
+static inline uintptr_t get_double_result_dependency(double result) {
+	uint64_t bits;
+	__asm__ ("movq %1, %0\n\tandq $0, %0" : "=r" (bits) : "x" (result));
+	return bits;
+}
+
+static inline uintptr_t get_integer_result_dependency(uint64_t result) {
+	__asm__ ("andq $0, %0" : "+r" (result));
+	return result;
+}
+
+/*
+ * The profile function samples group->count + group_quantity_count quantities: the group members, then the quantities
+ * of enum group_quantity. The overhead array has group->count + 1 entries, the last one for TSC ticks. Only the group
+ * members are summarized into counts and statistics; the caller summarizes the other quantities from the accumulators.
+ */
+#define DECLARE_PROFILE_FUNCTION(name, variant) \
+	bool name##variant##_profile(void* function, \
 		const struct name##_arguments arguments[restrict static 1], \
-		int perf_counter_descriptor, size_t max_iterations);
+		const struct cache_policy cache[restrict static 1], \
+		const struct performance_counter_group group[restrict static 1], \
+		const struct disturbance_counters disturbance[restrict static 1], \
+		const unsigned long long overhead[restrict static 1], \
+		const struct sampling_policy policy[restrict static 1], \
+		struct sample_accumulator accumulators[restrict static 1], \
+		unsigned long long counts[restrict static 1], \
+		struct measurement_statistics statistics[restrict static 1]);
 
-#define DEFINE_PROFILE_FUNCTION(name) \
-	unsigned long long name##_profile(void* name, \
+#define DEFINE_PROFILE_FUNCTION(name, variant) \
+	bool name##variant##_profile(void* function, \
 		const struct name##_arguments arguments[restrict static 1], \
-		int perf_counter_descriptor, size_t max_iterations) \
+		const struct cache_policy cache[restrict static 1], \
+		const struct performance_counter_group group[restrict static 1], \
+		const struct disturbance_counters disturbance[restrict static 1], \
+		const unsigned long long overhead[restrict static 1], \
+		const struct sampling_policy policy[restrict static 1], \
+		struct sample_accumulator accumulators[restrict static 1], \
+		unsigned long long counts[restrict static 1], \
+		struct measurement_statistics statistics[restrict static 1]) \
 	{ \
-		unsigned long long overhead_count[max_iterations]; \
-		size_t overhead_samples = 0; \
-		for (size_t iteration = 0; iteration < max_iterations; iteration++) { \
-			unsigned long long start_count = 0, end_count = 0; \
-			if (read(perf_counter_descriptor, &start_count, sizeof(start_count)) != sizeof(start_count)) \
+		if (group->file_descriptor == -1 || group->count == 0) \
+			return false; \
+	\
+		size_t copy = 0; \
+		for (size_t iteration = 0; iteration < cache->warmup_iterations; iteration++) { \
+			name##variant##_call(function, &arguments[copy]); \
+			copy = get_next_argument_copy(cache, copy); \
+		} \
+	\
+		size_t computation_samples = 0, rejected_samples = 0; \
+		size_t next_convergence_check = MIN_SAMPLES; \
+		for (size_t attempt = 0; attempt < 2 * policy->max_samples && is_sampling_allowed(policy, computation_samples); attempt++) { \
+			const struct name##_arguments* copy_arguments = &arguments[copy]; \
+			if (cache->mode == cache_mode_cold) \
+				flush_argument_copy(cache, copy); \
+			copy = get_next_argument_copy(cache, copy); \
+	\
+			struct disturbance_counter_values start_disturbances, end_disturbances; \
+			if (!read_disturbance_counters(disturbance, &start_disturbances)) \
+				continue; \
+			struct performance_counter_group_values start_values, end_values; \
+			if (!read_performance_counter_group(group, &start_values)) \
 				continue; \
 	\
-			uint32_t eax, ebx, ecx, edx; \
-			__cpuid(0, eax, ebx, ecx, edx); \
-			__cpuid(0, eax, ebx, ecx, edx); \
+			/* The fences order the TSC reads with the calls, and the counter reads bracket both */ \
+			const uint64_t start_tsc = read_fenced_tsc(policy->fence); \
+			if (policy->latency) \
+				name##variant##_call_chain(function, copy_arguments, policy->calls_per_sample); \
+			else \
+				name##variant##_call_block(function, copy_arguments, policy->calls_per_sample); \
+			const uint64_t end_tsc = read_fenced_tsc(policy->fence); \
 	\
-			if (read(perf_counter_descriptor, &end_count, sizeof(end_count)) != sizeof(end_count)) \
+			if (!read_performance_counter_group(group, &end_values)) \
 				continue; \
+			if (!read_disturbance_counters(disturbance, &end_disturbances)) \
+				continue; \
+			if (!is_performance_counter_group_sample_valid(&start_values, &end_values)) \
+				continue; \
+			/* Drop samples hit by a context switch, migration, page fault, or SMI */ \
+			if (is_sample_disturbed(disturbance, &start_disturbances, &end_disturbances)) { \
+				rejected_samples++; \
+				continue; \
+			} \
 	\
-			overhead_count[overhead_samples++] = end_count - start_count; \
+			for (size_t counter = 0; counter < group->count; counter++) \
+				add_sample(&accumulators[counter], end_values.values[counter] - start_values.values[counter]); \
+			add_sample(&accumulators[group->count + group_quantity_tsc_ticks], end_tsc - start_tsc); \
+			if (group->cycles_index != SIZE_MAX) { \
+				const unsigned long long frequency_ratio = compute_frequency_ratio( \
+					end_values.values[group->cycles_index] - start_values.values[group->cycles_index], \
+					overhead[group->cycles_index], end_tsc - start_tsc, overhead[group->count]); \
+				if (frequency_ratio != 0) \
+					add_sample(&accumulators[group->count + group_quantity_frequency_ratio], frequency_ratio); \
+			} \
+			computation_samples++; \
+	\
+			/* Check convergence after every 25% increase in the number of samples to amortize selection */ \
+			if (computation_samples >= next_convergence_check) { \
+				if (is_sampling_converged(policy, group->count, accumulators, overhead)) \
+					break; \
+				next_convergence_check = computation_samples + computation_samples / 4; \
+			} \
 		} \
 	\
 		/* Performance counters aren't working */ \
-		if (overhead_samples == 0) \
-			return ULLONG_MAX; \
+		if (computation_samples == 0) \
+			return false; \
 	\
-		unsigned long long computation_count[max_iterations]; \
-		size_t computation_samples = 0; \
-		for (size_t iteration = 0; iteration < max_iterations; iteration++) { \
-			unsigned long long start_count = 0, end_count = 0; \
-			if (read(perf_counter_descriptor, &start_count, sizeof(start_count)) != sizeof(start_count)) \
-				continue; \
-	\
-			uint32_t eax, ebx, ecx, edx; \
-			__cpuid(0, eax, ebx, ecx, edx); \
+		for (size_t counter = 0; counter < group->count; counter++) { \
+			counts[counter] = summarize_samples(&accumulators[counter], overhead[counter], policy->calls_per_sample, \
+				&statistics[counter]); \
+			statistics[counter].rejected_samples = rejected_samples; \
+		} \
+		return true; \
+	}
+
+#define DECLARE_SAMPLE_FUNCTION(name) \
+	void name##_sample(void* name, \
+		const struct name##_arguments arguments[restrict static 1], \
+		const struct sampling_counter counter[restrict static 1], size_t iterations, \
+		struct sample_histogram histogram[restrict static 1]);
+
+#define DEFINE_SAMPLE_FUNCTION(name) \
+	void name##_sample(void* name, \
+		const struct name##_arguments arguments[restrict static 1], \
+		const struct sampling_counter counter[restrict static 1], size_t iterations, \
+		struct sample_histogram histogram[restrict static 1]) \
+	{ \
+		for (size_t iteration = 0; iteration < iterations; iteration++) { \
 			name##_call(name, arguments); \
-			__cpuid(0, eax, ebx, ecx, edx); \
+			drain_sampling_counter(counter, histogram); \
+		} \
+	}
+
+#define DECLARE_TIME_FUNCTION(name, variant) \
+	bool name##variant##_time(void* function, \
+		const struct name##_arguments arguments[restrict static 1], \
+		const struct cache_policy cache[restrict static 1], \
+		const struct timing_backend backend[restrict static 1], \
+		const struct disturbance_counters disturbance[restrict static 1], \
+		const struct timing_counts overhead[restrict static 1], \
+		const struct sampling_policy policy[restrict static 1], \
+		struct sample_accumulator accumulators[restrict static timing_quantity_count], \
+		struct timing_counts counts[restrict static 1], \
+		struct measurement_statistics statistics[restrict static 1]);
+
+#define DEFINE_TIME_FUNCTION(name, variant) \
+	bool name##variant##_time(void* function, \
+		const struct name##_arguments arguments[restrict static 1], \
+		const struct cache_policy cache[restrict static 1], \
+		const struct timing_backend backend[restrict static 1], \
+		const struct disturbance_counters disturbance[restrict static 1], \
+		const struct timing_counts overhead[restrict static 1], \
+		const struct sampling_policy policy[restrict static 1], \
+		struct sample_accumulator accumulators[restrict static timing_quantity_count], \
+		struct timing_counts counts[restrict static 1], \
+		struct measurement_statistics statistics[restrict static 1]) \
+	{ \
+		size_t copy = 0; \
+		for (size_t iteration = 0; iteration < cache->warmup_iterations; iteration++) { \
+			name##variant##_call(function, &arguments[copy]); \
+			copy = get_next_argument_copy(cache, copy); \
+		} \
 	\
-			if (read(perf_counter_descriptor, &end_count, sizeof(end_count)) != sizeof(end_count)) \
+		size_t computation_samples = 0, rejected_samples = 0; \
+		size_t next_convergence_check = MIN_SAMPLES; \
+		for (size_t attempt = 0; attempt < 2 * policy->max_samples && is_sampling_allowed(policy, computation_samples); attempt++) { \
+			const struct name##_arguments* copy_arguments = &arguments[copy]; \
+			if (cache->mode == cache_mode_cold) \
+				flush_argument_copy(cache, copy); \
+			copy = get_next_argument_copy(cache, copy); \
+	\
+			struct disturbance_counter_values start_disturbances, end_disturbances; \
+			if (!read_disturbance_counters(disturbance, &start_disturbances)) \
+				continue; \
+			uint64_t start_nanoseconds, end_nanoseconds; \
+			if (!read_timing_clock(backend, &start_nanoseconds)) \
 				continue; \
+			const uint64_t start_tsc = read_fenced_tsc(policy->fence); \
+			if (policy->latency) \
+				name##variant##_call_chain(function, copy_arguments, policy->calls_per_sample); \
+			else \
+				name##variant##_call_block(function, copy_arguments, policy->calls_per_sample); \
+			const uint64_t end_tsc = read_fenced_tsc(policy->fence); \
+			if (!read_timing_clock(backend, &end_nanoseconds)) \
+				continue; \
+			if (!read_disturbance_counters(disturbance, &end_disturbances)) \
+				continue; \
+			if (is_sample_disturbed(disturbance, &start_disturbances, &end_disturbances)) { \
+				rejected_samples++; \
+				continue; \
+			} \
+	\
+			add_sample(&accumulators[timing_quantity_tsc_ticks], end_tsc - start_tsc); \
+			add_sample(&accumulators[timing_quantity_clock_nanoseconds], end_nanoseconds - start_nanoseconds); \
+			computation_samples++; \
 	\
-			computation_count[computation_samples++] = end_count - start_count; \
+			if (computation_samples >= next_convergence_check) { \
+				if (is_sampling_converged(policy, 1, &accumulators[timing_quantity_tsc_ticks], &overhead->tsc_ticks)) \
+					break; \
+				next_convergence_check = computation_samples + computation_samples / 4; \
+			} \
 		} \
 	\
-		const unsigned long long median_overhead_count = median(overhead_count, overhead_samples); \
-		const unsigned long long median_computation_count = median(computation_count, computation_samples); \
+		/* Clocks aren't working */ \
+		if (computation_samples == 0) \
+			return false; \
 	\
-		if (median_computation_count > median_overhead_count) \
-			return median_computation_count - median_overhead_count; \
-		else \
-			return 0; \
+		struct measurement_statistics clock_statistics; \
+		counts->tsc_ticks = summarize_samples(&accumulators[timing_quantity_tsc_ticks], overhead->tsc_ticks, \
+			policy->calls_per_sample, statistics); \
+		statistics->rejected_samples = rejected_samples; \
+		counts->clock_nanoseconds = summarize_samples(&accumulators[timing_quantity_clock_nanoseconds], \
+			overhead->clock_nanoseconds, policy->calls_per_sample, &clock_statistics); \
+		return true; \
 	}
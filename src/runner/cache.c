@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <inttypes.h>
+#include <cpuid.h>
+
+#include <unistd.h>
+
+#include <runner/cache.h>
+
+static const char* cache_mode_names[] = {
+	[cache_mode_warm] = "warm",
+	[cache_mode_cold] = "cold",
+	[cache_mode_rotate] = "rotate",
+};
+
+static size_t last_level_cache_size = 0;
+static bool clflushopt = false;
+static struct x86_cache_info cache_info;
+
+void init_cache_info(void) {
+	cache_info = get_x86_cache_info();
+	long cache_size = sysconf(_SC_LEVEL3_CACHE_SIZE);
+	if (cache_size <= 0) {
+		cache_size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+	}
+	if (cache_size <= 0 && cache_info.count != 0) {
+		cache_size = (long) cache_info.levels[cache_info.count - 1].size;
+	}
+	last_level_cache_size = cache_size > 0 ? (size_t) cache_size : 0;
+
+	uint32_t max_leaf, eax, ebx, ecx, edx;
+	__cpuid(0, max_leaf, ebx, ecx, edx);
+	if (max_leaf >= 7) {
+		/* Leaf 7, sub-leaf 0: EBX bit 23 indicates CLFLUSHOPT */
+		__cpuid_count(7, 0, eax, ebx, ecx, edx);
+		clflushopt = !!(ebx & (UINT32_C(1) << 23));
+	}
+}
+
+/* Without a known cache size, assume a large server LLC */
+static size_t get_rotation_cache_size(void) {
+	return last_level_cache_size != 0 ? last_level_cache_size : 64 * 1024 * 1024;
+}
+
+size_t get_last_level_cache_size(void) {
+	return last_level_cache_size;
+}
+
+const struct x86_cache_info* get_cache_info(void) {
+	return &cache_info;
+}
+
+size_t get_cache_sweep_sizes(size_t sizes[restrict static MAX_SWEEP_POINTS]) {
+	if (cache_info.count == 0) {
+		return 0;
+	}
+	size_t max_size = 2 * cache_info.levels[cache_info.count - 1].size;
+	if (max_size > MAX_SWEEP_WORKING_SET) {
+		max_size = MAX_SWEEP_WORKING_SET;
+	}
+	/* Start from the largest power of two within a quarter of the first-level cache */
+	size_t power_of_two = 1024;
+	while (power_of_two * 2 <= cache_info.levels[0].size / 4) {
+		power_of_two *= 2;
+	}
+	size_t count = 0;
+	for (; power_of_two <= max_size && count < MAX_SWEEP_POINTS; power_of_two *= 2) {
+		sizes[count++] = power_of_two;
+		if (power_of_two + power_of_two / 2 <= max_size && count < MAX_SWEEP_POINTS) {
+			sizes[count++] = power_of_two + power_of_two / 2;
+		}
+	}
+	return count;
+}
+
+void report_cache_hierarchy(int connection_socket) {
+	dprintf(connection_socket, "Cache hierarchy:");
+	for (size_t i = 0; i < cache_info.count; i++) {
+		dprintf(connection_socket, "%s L%"PRIu32" %zu KiB", i == 0 ? "" : ",", cache_info.levels[i].level, cache_info.levels[i].size / 1024);
+	}
+	dprintf(connection_socket, "\n");
+}
+
+bool is_clflushopt_supported(void) {
+	return clflushopt;
+}
+
+size_t get_argument_copy_count(enum cache_mode mode, size_t copy_footprint) {
+	if (mode != cache_mode_rotate || copy_footprint == 0) {
+		return 1;
+	}
+	const size_t copies = (2 * get_rotation_cache_size() + copy_footprint - 1) / copy_footprint;
+	return copies < MAX_ARGUMENT_COPIES ? copies + 1 : MAX_ARGUMENT_COPIES;
+}
+
+size_t get_argument_copy_stride(size_t arena_size, size_t alignment) {
+	size_t units = (arena_size + alignment - 1) / alignment;
+	if (units % 2 == 0) {
+		units += 1;
+	}
+	return units * alignment;
+}
+
+void report_cache_policy(int connection_socket, const struct cache_policy policy[restrict static 1]) {
+	size_t copy_size = 0;
+	for (size_t i = 0; i < policy->region_count; i++) {
+		copy_size += policy->regions[i].size;
+	}
+	dprintf(connection_socket, "Cache: %s (%zu warmup iterations, %zu argument copies of %zu KiB, LLC %zu KiB%s)\n",
+		cache_mode_names[policy->mode], policy->warmup_iterations, policy->argument_copies, copy_size / 1024,
+		last_level_cache_size / 1024,
+		policy->mode == cache_mode_cold ? (policy->clflushopt ? ", clflushopt" : ", clflush") : "");
+	if (policy->mode == cache_mode_rotate) {
+		const size_t footprint = policy->argument_copies * policy->copy_footprint;
+		if (footprint < 2 * get_rotation_cache_size()) {
+			dprintf(connection_socket,
+				"Cache rotation: %zu argument copies cover %zu KiB, less than twice the LLC; part of the arguments may stay in cache\n",
+				policy->argument_copies, footprint / 1024);
+		}
+	}
+}
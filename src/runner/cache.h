@@ -0,0 +1,156 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <immintrin.h>
+
+#include <runner/perfctr.h>
+
+/* Maximum number of argument copies in the rotating cache mode, which bounds the memory of the argument structures */
+#define MAX_ARGUMENT_COPIES (1024 * 1024)
+
+/* Size of a cache line on x86 */
+#define CACHE_LINE_SIZE 64
+
+enum cache_mode {
+	cache_mode_invalid = 0,
+	/* Call the kernel on the same arguments, which stay in cache after the warmup */
+	cache_mode_warm,
+	/* Flush the argument buffers from all cache levels before each kernel call */
+	cache_mode_cold,
+	/* Cycle through copies of arguments whose total size exceeds the last-level cache */
+	cache_mode_rotate,
+};
+
+enum sweep_mode {
+	sweep_mode_invalid = 0,
+	/* Measure the kernel with the parameters of the request */
+	sweep_mode_none,
+	/* Measure the kernel at working-set sizes around each level of the cache hierarchy */
+	sweep_mode_cache,
+};
+
+/* Maximum working set of a point of the cache sweep, which bounds the setup time and the memory of a request */
+#define MAX_SWEEP_WORKING_SET (128 * 1024 * 1024)
+
+/* Maximum number of points of the cache sweep */
+#define MAX_SWEEP_POINTS 64
+
+/**
+ * @brief Rounds a buffer size up to whole cache lines.
+ */
+static inline size_t align_cache_footprint(size_t size) {
+	return (size + CACHE_LINE_SIZE - 1) & -(size_t) CACHE_LINE_SIZE;
+}
+
+/* Memory which a kernel may access through a pointer argument */
+struct memory_region {
+	const void* address;
+	size_t size;
+};
+
+struct cache_policy {
+	enum cache_mode mode;
+	/* Number of kernel calls before the measurement */
+	size_t warmup_iterations;
+	/* Number of argument copies the measurement cycles through */
+	size_t argument_copies;
+	/* Mapping which holds the buffers of all argument copies, or NULL if the copies have no buffers */
+	void* arena;
+	size_t arena_size;
+	/* Bytes in the cache lines which the buffers of one argument copy occupy */
+	size_t copy_footprint;
+	/* Memory regions to flush before each kernel call in the cold mode */
+	const struct memory_region* regions;
+	/* Number of memory regions per argument copy */
+	size_t region_count;
+	/* The processor supports the CLFLUSHOPT instruction */
+	bool clflushopt;
+};
+
+/**
+ * @brief Detects the cache hierarchy, the size of the last-level cache, and the cache flush instructions.
+ * @details Must be called before the sandbox is enabled.
+ */
+void init_cache_info(void);
+
+/**
+ * @brief Returns the size of the last-level cache in bytes, or 0 if unknown.
+ */
+size_t get_last_level_cache_size(void);
+
+/**
+ * @brief Returns the data cache hierarchy detected by init_cache_info.
+ */
+const struct x86_cache_info* get_cache_info(void);
+
+/**
+ * @brief Selects working-set sizes which straddle every level of the cache hierarchy.
+ * @details Sizes are powers of two and 1.5 times powers of two, from a quarter of the first-level cache to twice the
+ *          last-level cache (at most MAX_SWEEP_WORKING_SET), so that consecutive sizes differ by at most a factor of 1.5.
+ * @param[out] sizes Working-set sizes in bytes, in increasing order.
+ * @return Number of sizes, or 0 if the cache hierarchy is unknown.
+ */
+size_t get_cache_sweep_sizes(size_t sizes[restrict static MAX_SWEEP_POINTS]);
+
+/**
+ * @brief Writes the detected data cache levels and their sizes to the connection socket.
+ */
+void report_cache_hierarchy(int connection_socket);
+
+/**
+ * @brief Checks if the processor supports the CLFLUSHOPT instruction.
+ */
+bool is_clflushopt_supported(void);
+
+/**
+ * @brief Computes the number of argument copies whose cache footprint is twice the last-level cache size.
+ * @details The count is capped at MAX_ARGUMENT_COPIES, so copies of small arguments may cover less than that;
+ *          report_cache_policy warns about it.
+ * @param[in] mode            Cache mode. Only the rotating mode uses multiple copies.
+ * @param[in] copy_footprint  Bytes in the cache lines which the buffers of one argument copy occupy.
+ */
+size_t get_argument_copy_count(enum cache_mode mode, size_t copy_footprint);
+
+/**
+ * @brief Computes the distance between consecutive argument copies packed into one arena.
+ * @details The stride is an odd multiple of the arena alignment, so unless the copies are smaller than the alignment it
+ *          is not a power of two, and the copies start in different cache sets instead of competing for the same ones.
+ * @param[in] arena_size  Size of the buffers of one argument copy, including alignment padding.
+ * @param[in] alignment   Power-of-two alignment of each copy, at least CACHE_LINE_SIZE.
+ */
+size_t get_argument_copy_stride(size_t arena_size, size_t alignment);
+
+/**
+ * @brief Writes the cache mode, the warmup iterations and the memory footprint of arguments to the connection socket.
+ */
+void report_cache_policy(int connection_socket, const struct cache_policy policy[restrict static 1]);
+
+/**
+ * @brief Returns the index of the argument copy to use after the given one.
+ */
+static inline size_t get_next_argument_copy(const struct cache_policy policy[restrict static 1], size_t copy) {
+	return copy + 1 < policy->argument_copies ? copy + 1 : 0;
+}
+
+/**
+ * @brief Evicts the memory regions of an argument copy from all cache levels.
+ * @details The function waits until the flushes complete, so that they do not overlap with the measured kernel call.
+ */
+static inline void flush_argument_copy(const struct cache_policy policy[restrict static 1], size_t copy) {
+	const struct memory_region* regions = &policy->regions[copy * policy->region_count];
+	for (size_t i = 0; i < policy->region_count; i++) {
+		const uintptr_t start = (uintptr_t) regions[i].address & -(uintptr_t) CACHE_LINE_SIZE;
+		const uintptr_t end = (uintptr_t) regions[i].address + regions[i].size;
+		for (uintptr_t line = start; line < end; line += CACHE_LINE_SIZE) {
+			if (policy->clflushopt) {
+				/* The CLFLUSHOPT intrinsic requires -mclflushopt, so use inline assembly to keep the CLFLUSH fallback */
+				__asm__ __volatile__ ("clflushopt (%0)" :: "r" (line) : "memory");
+			} else {
+				_mm_clflush((const void*) line);
+			}
+		}
+	}
+	_mm_mfence();
+}
@@ -0,0 +1,305 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <unistd.h>
+
+#include <webserver/logs.h>
+#include <runner/benchmark.h>
+#include <runner/calibration.h>
+
+struct performance_counter_overhead {
+	const char* name;
+	struct overhead_distribution distribution;
+};
+
+/* Timing backends differ by the clock they read besides the TSC */
+enum timing_clock {
+	timing_clock_task_clock,
+	timing_clock_monotonic_raw,
+	timing_clock_count,
+};
+
+static const char* timing_clock_names[timing_clock_count] = {
+	[timing_clock_task_clock] = "task clock",
+	[timing_clock_monotonic_raw] = "CLOCK_MONOTONIC_RAW",
+};
+
+static struct {
+	time_t time;
+	struct performance_counter_overhead* counters;
+	size_t counter_count;
+	/* Fence strategy with the least variable overhead, which the other calibrations use */
+	enum fence_strategy fence;
+	bool fence_calibrated[fence_strategy_count];
+	struct overhead_distribution fence_tsc_ticks[fence_strategy_count];
+	bool timing_calibrated[timing_clock_count];
+	/* TSC ticks around an empty region in the profile function, which reads the fenced TSC on both ends */
+	bool group_tsc_calibrated;
+	struct overhead_distribution group_tsc_ticks;
+	struct overhead_distribution tsc_ticks[timing_clock_count];
+	struct overhead_distribution clock_nanoseconds[timing_clock_count];
+} calibration;
+
+/* Summarizes measurements; the array is reordered in the process */
+static struct overhead_distribution summarize_overhead(unsigned long long measurements[restrict static 1], size_t count) {
+	const unsigned long long median_measurement = median(measurements, count);
+	return (struct overhead_distribution) {
+		.median = median_measurement,
+		.low = select_order_statistic(measurements, count, count / 10),
+		.high = select_order_statistic(measurements, count, count - 1 - count / 10),
+		.samples = count,
+	};
+}
+
+bool measure_performance_counter_group_overhead(const struct performance_counter_group group[restrict static 1],
+	enum fence_strategy fence, size_t iterations, struct overhead_distribution overhead[restrict static 1])
+{
+	if (group->file_descriptor == -1 || group->count == 0) {
+		return false;
+	}
+
+	unsigned long long measurements[group->count + 1][iterations];
+	size_t samples = 0;
+	for (size_t iteration = 0; iteration < iterations; iteration++) {
+		struct performance_counter_group_values start_values, end_values;
+		if (!read_performance_counter_group(group, &start_values)) {
+			continue;
+		}
+
+		const uint64_t start_tsc = read_fenced_tsc(fence);
+		const uint64_t end_tsc = read_fenced_tsc(fence);
+
+		if (!read_performance_counter_group(group, &end_values)) {
+			continue;
+		}
+		if (!is_performance_counter_group_sample_valid(&start_values, &end_values)) {
+			continue;
+		}
+
+		for (size_t counter = 0; counter < group->count; counter++) {
+			measurements[counter][samples] = end_values.values[counter] - start_values.values[counter];
+		}
+		measurements[group->count][samples] = end_tsc - start_tsc;
+		samples++;
+	}
+
+	/* Performance counters aren't working */
+	if (samples == 0) {
+		return false;
+	}
+
+	for (size_t counter = 0; counter <= group->count; counter++) {
+		overhead[counter] = summarize_overhead(measurements[counter], samples);
+	}
+	return true;
+}
+
+bool measure_timing_overhead(const struct timing_backend backend[restrict static 1], enum fence_strategy fence, size_t iterations,
+	struct overhead_distribution tsc_ticks[restrict static 1],
+	struct overhead_distribution clock_nanoseconds[restrict static 1])
+{
+	unsigned long long tick_measurements[iterations], nanosecond_measurements[iterations];
+	size_t samples = 0;
+	for (size_t iteration = 0; iteration < iterations; iteration++) {
+		uint64_t start_nanoseconds, end_nanoseconds;
+		if (!read_timing_clock(backend, &start_nanoseconds)) {
+			continue;
+		}
+		const uint64_t start_tsc = read_fenced_tsc(fence);
+		const uint64_t end_tsc = read_fenced_tsc(fence);
+		if (!read_timing_clock(backend, &end_nanoseconds)) {
+			continue;
+		}
+
+		tick_measurements[samples] = end_tsc - start_tsc;
+		nanosecond_measurements[samples] = end_nanoseconds - start_nanoseconds;
+		samples++;
+	}
+
+	/* Clocks aren't working */
+	if (samples == 0) {
+		return false;
+	}
+
+	*tsc_ticks = summarize_overhead(tick_measurements, samples);
+	*clock_nanoseconds = summarize_overhead(nanosecond_measurements, samples);
+	return true;
+}
+
+static enum timing_clock get_timing_clock(const struct timing_backend backend[restrict static 1]) {
+	return backend->task_clock_file_descriptor != -1 ? timing_clock_task_clock : timing_clock_monotonic_raw;
+}
+
+/* Measures an empty region between two fenced TSC reads */
+static struct overhead_distribution measure_fence_overhead(enum fence_strategy fence, size_t iterations) {
+	unsigned long long measurements[iterations];
+	for (size_t iteration = 0; iteration < iterations; iteration++) {
+		const uint64_t start_tsc = read_fenced_tsc(fence);
+		const uint64_t end_tsc = read_fenced_tsc(fence);
+		measurements[iteration] = end_tsc - start_tsc;
+	}
+	return summarize_overhead(measurements, iterations);
+}
+
+/* Picks the supported fence strategy with the narrowest spread of overhead, and the lowest median among equals */
+static void select_fence_strategy(void) {
+	calibration.fence = fence_strategy_cpuid;
+	for (enum fence_strategy fence = fence_strategy_cpuid; fence < fence_strategy_count; fence++) {
+		calibration.fence_calibrated[fence] = is_fence_strategy_supported(fence);
+		if (!calibration.fence_calibrated[fence]) {
+			continue;
+		}
+		calibration.fence_tsc_ticks[fence] = measure_fence_overhead(fence, CALIBRATION_ITERATIONS);
+		const struct overhead_distribution* distribution = &calibration.fence_tsc_ticks[fence];
+		const struct overhead_distribution* best = &calibration.fence_tsc_ticks[calibration.fence];
+		const unsigned long long spread = distribution->high - distribution->low;
+		const unsigned long long best_spread = best->high - best->low;
+		if (spread < best_spread || (spread == best_spread && distribution->median < best->median)) {
+			calibration.fence = fence;
+		}
+	}
+}
+
+void calibrate_measurement_overhead(void) {
+	select_fence_strategy();
+	struct performance_counters performance_counters = init_performance_counters(0, NULL);
+	struct performance_counter_overhead* counters = (struct performance_counter_overhead*)
+		malloc(performance_counters.count * sizeof(struct performance_counter_overhead));
+	size_t counter_count = 0;
+	calibration.group_tsc_calibrated = false;
+	for (size_t group_index = 0; group_index < performance_counters.group_count; group_index++) {
+		const struct performance_counter_group* group = &performance_counters.groups[group_index];
+		struct overhead_distribution overhead[MAX_GROUP_COUNTERS + 1];
+		ioctl(group->file_descriptor, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+		const bool success = measure_performance_counter_group_overhead(group, calibration.fence, CALIBRATION_ITERATIONS, overhead);
+		ioctl(group->file_descriptor, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+		if (success) {
+			for (size_t i = 0; i < group->count; i++) {
+				counters[counter_count++] = (struct performance_counter_overhead) {
+					.name = performance_counters.counters[group->counter_index[i]].name,
+					.distribution = overhead[i],
+				};
+			}
+			if (!calibration.group_tsc_calibrated) {
+				calibration.group_tsc_ticks = overhead[group->count];
+				calibration.group_tsc_calibrated = true;
+			}
+		}
+	}
+	release_performance_counters(&performance_counters);
+
+	free(calibration.counters);
+	calibration.counters = counters;
+	calibration.counter_count = counter_count;
+
+	struct timing_backend timing_backend = init_timing_backend();
+	if (timing_backend.task_clock_file_descriptor != -1) {
+		calibration.timing_calibrated[timing_clock_task_clock] = measure_timing_overhead(&timing_backend,
+			calibration.fence, CALIBRATION_ITERATIONS,
+			&calibration.tsc_ticks[timing_clock_task_clock],
+			&calibration.clock_nanoseconds[timing_clock_task_clock]);
+		close(timing_backend.task_clock_file_descriptor);
+		timing_backend.task_clock_file_descriptor = -1;
+	}
+	calibration.timing_calibrated[timing_clock_monotonic_raw] = measure_timing_overhead(&timing_backend,
+		calibration.fence, CALIBRATION_ITERATIONS,
+		&calibration.tsc_ticks[timing_clock_monotonic_raw],
+		&calibration.clock_nanoseconds[timing_clock_monotonic_raw]);
+
+	calibration.time = time(NULL);
+}
+
+time_t get_calibration_time(void) {
+	return calibration.time;
+}
+
+enum fence_strategy get_default_fence_strategy(void) {
+	return calibration.fence != fence_strategy_invalid ? calibration.fence : fence_strategy_cpuid;
+}
+
+bool get_performance_counter_group_overhead(const struct performance_counters performance_counters[restrict static 1],
+	const struct performance_counter_group group[restrict static 1], enum fence_strategy fence,
+	unsigned long long overhead[restrict static 1])
+{
+	bool calibrated = calibration.group_tsc_calibrated && fence == calibration.fence;
+	overhead[group->count] = calibration.group_tsc_ticks.median;
+	for (size_t i = 0; i < group->count && calibrated; i++) {
+		const char* name = performance_counters->counters[group->counter_index[i]].name;
+		calibrated = false;
+		for (size_t j = 0; j < calibration.counter_count; j++) {
+			if (strcmp(calibration.counters[j].name, name) == 0) {
+				overhead[i] = calibration.counters[j].distribution.median;
+				calibrated = true;
+				break;
+			}
+		}
+	}
+	if (calibrated) {
+		return true;
+	}
+
+	struct overhead_distribution distributions[MAX_GROUP_COUNTERS + 1];
+	if (!measure_performance_counter_group_overhead(group, fence, REQUEST_CALIBRATION_ITERATIONS, distributions)) {
+		return false;
+	}
+	for (size_t i = 0; i <= group->count; i++) {
+		overhead[i] = distributions[i].median;
+	}
+	return true;
+}
+
+bool get_timing_overhead(const struct timing_backend backend[restrict static 1], enum fence_strategy fence,
+	struct timing_counts overhead[restrict static 1])
+{
+	const enum timing_clock clock = get_timing_clock(backend);
+	struct overhead_distribution tsc_ticks, clock_nanoseconds;
+	if (calibration.timing_calibrated[clock] && fence == calibration.fence) {
+		tsc_ticks = calibration.tsc_ticks[clock];
+		clock_nanoseconds = calibration.clock_nanoseconds[clock];
+	} else if (!measure_timing_overhead(backend, fence, REQUEST_CALIBRATION_ITERATIONS, &tsc_ticks, &clock_nanoseconds)) {
+		return false;
+	}
+	overhead->tsc_ticks = tsc_ticks.median;
+	overhead->clock_nanoseconds = clock_nanoseconds.median;
+	return true;
+}
+
+static void report_overhead_distribution(int connection_socket, const char* name,
+	const struct overhead_distribution distribution[restrict static 1])
+{
+	dprintf(connection_socket, "%s: %llu (p10 %llu, p90 %llu, %zu samples)\n", name,
+		distribution->median, distribution->low, distribution->high, distribution->samples);
+}
+
+void report_measurement_overhead(int connection_socket) {
+	dprintf(connection_socket, "Calibration age (s): %lld\n", (long long) (time(NULL) - calibration.time));
+	const char* fence_name = get_fence_strategy_name(calibration.fence);
+	dprintf(connection_socket, "Fence: %s\n", fence_name);
+	for (enum fence_strategy fence = fence_strategy_cpuid; fence < fence_strategy_count; fence++) {
+		if (calibration.fence_calibrated[fence]) {
+			char name[256];
+			snprintf(name, sizeof(name), "Fence overhead in TSC ticks (%s)", get_fence_strategy_name(fence));
+			report_overhead_distribution(connection_socket, name, &calibration.fence_tsc_ticks[fence]);
+		}
+	}
+	for (size_t i = 0; i < calibration.counter_count; i++) {
+		char name[256];
+		snprintf(name, sizeof(name), "%s overhead (%s)", calibration.counters[i].name, fence_name);
+		report_overhead_distribution(connection_socket, name, &calibration.counters[i].distribution);
+	}
+	if (calibration.group_tsc_calibrated) {
+		char name[256];
+		snprintf(name, sizeof(name), "TSC ticks overhead (%s, performance counters)", fence_name);
+		report_overhead_distribution(connection_socket, name, &calibration.group_tsc_ticks);
+	}
+	for (enum timing_clock clock = 0; clock < timing_clock_count; clock++) {
+		if (calibration.timing_calibrated[clock]) {
+			char name[256];
+			snprintf(name, sizeof(name), "TSC ticks overhead (%s, %s)", fence_name, timing_clock_names[clock]);
+			report_overhead_distribution(connection_socket, name, &calibration.tsc_ticks[clock]);
+			snprintf(name, sizeof(name), "Clock overhead in ns (%s)", timing_clock_names[clock]);
+			report_overhead_distribution(connection_socket, name, &calibration.clock_nanoseconds[clock]);
+		}
+	}
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include <runner/perfctr.h>
+#include <runner/timing.h>
+#include <runner/fence.h>
+
+/* Number of measurements of an empty region in the startup calibration */
+#define CALIBRATION_ITERATIONS 1000
+
+/* Number of measurements of an empty region when a request can not use the cached calibration */
+#define REQUEST_CALIBRATION_ITERATIONS 100
+
+struct overhead_distribution {
+	unsigned long long median;
+	/* 10th percentile */
+	unsigned long long low;
+	/* 90th percentile */
+	unsigned long long high;
+	size_t samples;
+};
+
+/**
+ * @brief Measures the overhead of reading an enabled performance counter group around an empty fenced region.
+ * @param[in]  group      Performance counter group to measure. The group must be enabled.
+ * @param[in]  fence      Fences around the TSC reads which bracket the region.
+ * @param[in]  iterations Number of measurements.
+ * @param[out] overhead   Overhead distribution for each member of the group, followed by the overhead in TSC ticks.
+ * @return true if at least one measurement succeeded, false otherwise.
+ */
+bool measure_performance_counter_group_overhead(const struct performance_counter_group group[restrict static 1],
+	enum fence_strategy fence, size_t iterations, struct overhead_distribution overhead[restrict static 1]);
+
+/**
+ * @brief Measures the overhead of the timing backend around an empty serialized region.
+ * @param[in]  backend           Timing backend to measure.
+ * @param[in]  fence             Fences around the TSC reads which bracket the region.
+ * @param[in]  iterations        Number of measurements.
+ * @param[out] tsc_ticks         Overhead distribution in TSC ticks.
+ * @param[out] clock_nanoseconds Overhead distribution in nanoseconds of the backend clock.
+ * @return true if at least one measurement succeeded, false otherwise.
+ */
+bool measure_timing_overhead(const struct timing_backend backend[restrict static 1], enum fence_strategy fence, size_t iterations,
+	struct overhead_distribution tsc_ticks[restrict static 1],
+	struct overhead_distribution clock_nanoseconds[restrict static 1]);
+
+/**
+ * @brief Selects the fence strategy and measures the overhead of all performance counters in the active event table and
+ *        of the timing backend.
+ * @details The results are cached and inherited by the request processes. The function must be called after
+ *          init_performance_event_table and init_tsc_frequency, and outside of the sandbox.
+ */
+void calibrate_measurement_overhead(void);
+
+/**
+ * @brief Returns the time of the last calibration, or 0 if the overhead was never calibrated.
+ */
+time_t get_calibration_time(void);
+
+/**
+ * @brief Returns the fence strategy with the least variable overhead on this machine, or CPUID if the overhead was never
+ *        calibrated.
+ */
+enum fence_strategy get_default_fence_strategy(void);
+
+/**
+ * @brief Looks up the calibrated overhead of the members of a performance counter group.
+ * @details If some member was not calibrated, the function measures the overhead of the whole group instead.
+ *          The group must be enabled.
+ * @param[in]  performance_counters Performance counters which the group refers to.
+ * @param[in]  group                Performance counter group.
+ * @param[in]  fence                Fences around the TSC reads which bracket the measured region.
+ * @param[out] overhead             Median overhead for each member of the group, followed by the overhead in TSC ticks.
+ * @return true if the overhead is known, false otherwise.
+ */
+bool get_performance_counter_group_overhead(const struct performance_counters performance_counters[restrict static 1],
+	const struct performance_counter_group group[restrict static 1], enum fence_strategy fence,
+	unsigned long long overhead[restrict static 1]);
+
+/**
+ * @brief Looks up the calibrated overhead of a timing backend, or measures it if the clock was not calibrated.
+ * @return true if the overhead is known, false otherwise.
+ */
+bool get_timing_overhead(const struct timing_backend backend[restrict static 1], enum fence_strategy fence,
+	struct timing_counts overhead[restrict static 1]);
+
+/**
+ * @brief Writes the cached calibration to the connection socket, one event or clock per line.
+ */
+void report_measurement_overhead(int connection_socket);
@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <errno.h>
+
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include <webserver/logs.h>
+#include <runner/disturbance.h>
+
+/* Linux exposes the SMI count MSR as an event of the msr PMU */
+#define MSR_PMU_TYPE_PATH "/sys/bus/event_source/devices/msr/type"
+#define MSR_PMU_SMI_EVENT_PATH "/sys/bus/event_source/devices/msr/events/smi"
+#define MSR_PMU_SMI_CONFIG 0x04
+
+static const char* disturbance_event_names[disturbance_event_count] = {
+	[disturbance_event_context_switches] = "context switches",
+	[disturbance_event_cpu_migrations] = "CPU migrations",
+	[disturbance_event_page_faults] = "page faults",
+	[disturbance_event_smis] = "SMIs",
+};
+
+static int perf_event_open(struct perf_event_attr *hw_event, pid_t pid, int cpu, int group_fd, unsigned long flags) {
+	return syscall(__NR_perf_event_open, hw_event, pid, cpu, group_fd, flags);
+}
+
+static int open_disturbance_counter(uint32_t type, uint64_t config, int group_fd) {
+	struct perf_event_attr perf_event_attr;
+	memset(&perf_event_attr, 0, sizeof(perf_event_attr));
+	perf_event_attr.type = type;
+	perf_event_attr.size = sizeof(perf_event_attr);
+	perf_event_attr.config = config;
+	/* The msr PMU rejects events with any exclude_* bit set (PERF_PMU_CAP_NO_EXCLUDE), so set it only for software events */
+	perf_event_attr.exclude_hv = type == PERF_TYPE_SOFTWARE;
+	perf_event_attr.read_format = PERF_FORMAT_GROUP;
+	return perf_event_open(&perf_event_attr, 0, -1, group_fd, 0);
+}
+
+/* Returns the perf event type of the msr PMU if it can count SMIs, or 0 otherwise */
+static uint32_t get_msr_pmu_type(void) {
+	if (access(MSR_PMU_SMI_EVENT_PATH, R_OK) != 0) {
+		return 0;
+	}
+	FILE* file = fopen(MSR_PMU_TYPE_PATH, "r");
+	if (file == NULL) {
+		return 0;
+	}
+	uint32_t type = 0;
+	if (fscanf(file, "%"SCNu32, &type) != 1) {
+		type = 0;
+	}
+	fclose(file);
+	return type;
+}
+
+struct disturbance_counters init_disturbance_counters(void) {
+	struct disturbance_counters counters = {
+		.file_descriptor = -1,
+	};
+	const uint32_t types[disturbance_event_count] = {
+		[disturbance_event_context_switches] = PERF_TYPE_SOFTWARE,
+		[disturbance_event_cpu_migrations] = PERF_TYPE_SOFTWARE,
+		[disturbance_event_page_faults] = PERF_TYPE_SOFTWARE,
+		[disturbance_event_smis] = get_msr_pmu_type(),
+	};
+	const uint64_t configs[disturbance_event_count] = {
+		[disturbance_event_context_switches] = PERF_COUNT_SW_CONTEXT_SWITCHES,
+		[disturbance_event_cpu_migrations] = PERF_COUNT_SW_CPU_MIGRATIONS,
+		[disturbance_event_page_faults] = PERF_COUNT_SW_PAGE_FAULTS,
+		[disturbance_event_smis] = MSR_PMU_SMI_CONFIG,
+	};
+	for (enum disturbance_event event = 0; event < disturbance_event_count; event++) {
+		if (event == disturbance_event_smis && types[event] == 0) {
+			continue;
+		}
+		const int file_descriptor = open_disturbance_counter(types[event], configs[event], counters.file_descriptor);
+		if (file_descriptor != -1) {
+			if (counters.file_descriptor == -1) {
+				counters.file_descriptor = file_descriptor;
+			}
+			counters.events[counters.count++] = event;
+		} else {
+			log_error("failed to open disturbance counter for %s: %s\n", disturbance_event_names[event], strerror(errno));
+		}
+	}
+	return counters;
+}
+
+void report_rejected_samples(int connection_socket, const struct disturbance_counters counters[restrict static 1],
+	size_t rejected_samples, size_t accepted_samples)
+{
+	if (counters->file_descriptor == -1) {
+		return;
+	}
+	char events[256] = { 0 };
+	for (size_t i = 0; i < counters->count; i++) {
+		const size_t length = strlen(events);
+		snprintf(&events[length], sizeof(events) - length, "%s%s", i == 0 ? "" : ", ",
+			disturbance_event_names[counters->events[i]]);
+	}
+	const size_t total_samples = rejected_samples + accepted_samples;
+	dprintf(connection_socket, "Rejected samples: %zu of %zu (%.1f%%; %s)\n", rejected_samples, total_samples,
+		total_samples != 0 ? 100.0 * (double) rejected_samples / (double) total_samples : 0.0, events);
+}
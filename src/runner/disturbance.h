@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <unistd.h>
+
+/* Events which disturb a measurement: the sample is not representative if any of them happened during a kernel call */
+enum disturbance_event {
+	disturbance_event_context_switches,
+	disturbance_event_cpu_migrations,
+	disturbance_event_page_faults,
+	/* System management interrupts, counted by the msr PMU on x86 */
+	disturbance_event_smis,
+	disturbance_event_count,
+};
+
+struct disturbance_counters {
+	/* File descriptor of the group leader, or -1 if no disturbance events could be counted */
+	int file_descriptor;
+	/* Number of counters in the group */
+	size_t count;
+	/* Disturbance event of each counter in the group */
+	enum disturbance_event events[disturbance_event_count];
+};
+
+/* Layout of a read from a group leader with PERF_FORMAT_GROUP */
+struct disturbance_counter_values {
+	uint64_t count;
+	uint64_t values[disturbance_event_count];
+};
+
+/**
+ * @brief Opens a group of software counters for context switches, CPU migrations and page faults, and a counter of
+ *        system management interrupts where the kernel exposes one.
+ * @details Must be called before the sandbox is enabled, because the sandbox forbids perf_event_open. The counters
+ *          count events in both user and kernel mode: context switches and migrations only happen in the kernel.
+ */
+struct disturbance_counters init_disturbance_counters(void);
+
+/**
+ * @brief Reads the values of all disturbance counters.
+ * @return true if the read succeeded or no counters are open, false otherwise.
+ */
+static inline bool read_disturbance_counters(const struct disturbance_counters counters[restrict static 1],
+	struct disturbance_counter_values values[restrict static 1])
+{
+	if (counters->file_descriptor == -1) {
+		return true;
+	}
+	const size_t read_size = (1 + counters->count) * sizeof(uint64_t);
+	return read(counters->file_descriptor, values, read_size) == read_size;
+}
+
+/**
+ * @brief Checks if any disturbance event happened between two reads of the disturbance counters.
+ */
+static inline bool is_sample_disturbed(const struct disturbance_counters counters[restrict static 1],
+	const struct disturbance_counter_values start_values[restrict static 1],
+	const struct disturbance_counter_values end_values[restrict static 1])
+{
+	if (counters->file_descriptor == -1) {
+		return false;
+	}
+	for (size_t i = 0; i < counters->count; i++) {
+		if (end_values->values[i] != start_values->values[i]) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * @brief Writes the list of counted disturbance events and the share of rejected samples to the connection socket.
+ * @param[in] rejected_samples Number of samples dropped because a disturbance event happened during the kernel call.
+ * @param[in] accepted_samples Number of samples used in the statistics.
+ */
+void report_rejected_samples(int connection_socket, const struct disturbance_counters counters[restrict static 1],
+	size_t rejected_samples, size_t accepted_samples);
@@ -0,0 +1,45 @@
+#include <stdio.h>
+
+#include <runner/fence.h>
+
+static const char* fence_strategy_names[fence_strategy_count] = {
+	[fence_strategy_invalid] = "invalid",
+	[fence_strategy_cpuid] = "cpuid+rdtsc+lfence",
+	[fence_strategy_lfence] = "lfence+rdtsc",
+	[fence_strategy_rdtscp] = "rdtscp+lfence",
+	[fence_strategy_serialize] = "serialize",
+};
+
+bool is_fence_strategy_supported(enum fence_strategy fence) {
+	uint32_t max_leaf, eax, ebx, ecx, edx;
+	switch (fence) {
+		case fence_strategy_cpuid:
+		case fence_strategy_lfence:
+			/* LFENCE is part of SSE2, which all x86-64 processors support */
+			return true;
+		case fence_strategy_rdtscp:
+			__cpuid(0x80000000, max_leaf, ebx, ecx, edx);
+			if (max_leaf < 0x80000001) {
+				return false;
+			}
+			__cpuid(0x80000001, eax, ebx, ecx, edx);
+			return !!(edx & (UINT32_C(1) << 27));
+		case fence_strategy_serialize:
+			__cpuid(0, max_leaf, ebx, ecx, edx);
+			if (max_leaf < 7) {
+				return false;
+			}
+			__cpuid_count(7, 0, eax, ebx, ecx, edx);
+			return !!(edx & (UINT32_C(1) << 14));
+		default:
+			return false;
+	}
+}
+
+const char* get_fence_strategy_name(enum fence_strategy fence) {
+	return fence < fence_strategy_count ? fence_strategy_names[fence] : fence_strategy_names[fence_strategy_invalid];
+}
+
+void report_fence_strategy(int connection_socket, enum fence_strategy fence, bool automatic) {
+	dprintf(connection_socket, "Fence: %s (%s)\n", get_fence_strategy_name(fence), automatic ? "lowest overhead variance" : "requested");
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <cpuid.h>
+#include <x86intrin.h>
+
+/* Instruction sequences which keep the measured region from overlapping with the TSC reads around it */
+enum fence_strategy {
+	fence_strategy_invalid = 0,
+	/* CPUID before RDTSC and LFENCE after it. Fully serializing, but CPUID traps to the hypervisor in virtual machines. */
+	fence_strategy_cpuid,
+	/* LFENCE on both sides of RDTSC. Orders RDTSC on Intel, and on AMD if LFENCE is dispatch-serializing. */
+	fence_strategy_lfence,
+	/* RDTSCP, which waits for preceding instructions, followed by LFENCE */
+	fence_strategy_rdtscp,
+	/* SERIALIZE before RDTSC and LFENCE after it, on processors with the SERIALIZE instruction */
+	fence_strategy_serialize,
+	fence_strategy_count,
+};
+
+/**
+ * @brief Reads the TSC with the given fences. The same sequence starts and ends a measured region.
+ */
+static inline uint64_t read_fenced_tsc(enum fence_strategy fence) {
+	uint32_t eax, ebx, ecx, edx;
+	uint64_t tsc;
+	switch (fence) {
+		case fence_strategy_lfence:
+			_mm_lfence();
+			tsc = __rdtsc();
+			_mm_lfence();
+			return tsc;
+		case fence_strategy_rdtscp:
+		{
+			uint32_t aux;
+			tsc = __rdtscp(&aux);
+			_mm_lfence();
+			return tsc;
+		}
+		case fence_strategy_serialize:
+			/* SERIALIZE is encoded directly because older assemblers do not know it */
+			__asm__ __volatile__ (".byte 0x0F, 0x01, 0xE8" ::: "memory");
+			tsc = __rdtsc();
+			_mm_lfence();
+			return tsc;
+		default:
+			__cpuid(0, eax, ebx, ecx, edx);
+			tsc = __rdtsc();
+			/* CPUID orders RDTSC after the preceding instructions; LFENCE keeps the following ones from starting early */
+			_mm_lfence();
+			return tsc;
+	}
+}
+
+/**
+ * @brief Checks if the processor supports the instructions of a fence strategy.
+ */
+bool is_fence_strategy_supported(enum fence_strategy fence);
+
+/**
+ * @brief Returns a human-readable name of a fence strategy.
+ */
+const char* get_fence_strategy_name(enum fence_strategy fence);
+
+/**
+ * @brief Writes the fence strategy of the measurement to the connection socket.
+ * @param[in] automatic The strategy was selected at startup rather than requested.
+ */
+void report_fence_strategy(int connection_socket, enum fence_strategy fence, bool automatic);
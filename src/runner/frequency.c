@@ -0,0 +1,49 @@
+#include <stdio.h>
+#include <inttypes.h>
+
+#include <runner/frequency.h>
+
+bool summarize_frequency(struct sample_accumulator accumulator[restrict static 1],
+	struct frequency_statistics statistics[restrict static 1])
+{
+	if (accumulator->count == 0) {
+		return false;
+	}
+	const double scale = (double) FREQUENCY_RATIO_SCALE;
+	statistics->samples = accumulator->count;
+	statistics->ratio = (double) get_sample_quantile(accumulator, 0.5) / scale;
+	statistics->low_ratio = (double) get_sample_quantile(accumulator, 0.1) / scale;
+	statistics->high_ratio = (double) get_sample_quantile(accumulator, 0.9) / scale;
+	statistics->drift = statistics->ratio != 0.0 ? (statistics->high_ratio - statistics->low_ratio) / statistics->ratio : 0.0;
+	return true;
+}
+
+void report_frequency(int connection_socket, const struct frequency_statistics statistics[restrict static 1],
+	uint64_t tsc_frequency, double max_drift, size_t retries)
+{
+	if (tsc_frequency != 0) {
+		const double megahertz = (double) tsc_frequency * 1.0e-6;
+		dprintf(connection_socket, "Effective frequency (MHz): %.0lf (%.3lf of TSC, p10 %.0lf, p90 %.0lf, %zu samples)\n",
+			statistics->ratio * megahertz, statistics->ratio,
+			statistics->low_ratio * megahertz, statistics->high_ratio * megahertz, statistics->samples);
+	} else {
+		dprintf(connection_socket, "Effective frequency: %.3lf of TSC (p10 %.3lf, p90 %.3lf, %zu samples)\n",
+			statistics->ratio, statistics->low_ratio, statistics->high_ratio, statistics->samples);
+	}
+	if (statistics->drift > max_drift) {
+		dprintf(connection_socket, "Frequency drift: %.1lf%% exceeds %.1lf%% after %zu retries; cycle counts are unreliable\n",
+			100.0 * statistics->drift, 100.0 * max_drift, retries);
+	}
+}
+
+void report_nominal_timing(int connection_socket, unsigned long long tsc_ticks,
+	const struct measurement_statistics statistics[restrict static 1], uint64_t tsc_frequency)
+{
+	dprintf(connection_socket, "TSC ticks: %llu (+/-%.1f%%, %zu samples)\n", tsc_ticks,
+		100.0 * statistics->precision, statistics->samples);
+	report_tail_quantiles(connection_socket, "TSC ticks", statistics);
+	if (tsc_frequency != 0) {
+		dprintf(connection_socket, "Time at nominal frequency (ns): %llu\n",
+			(unsigned long long) ((double) tsc_ticks * 1.0e+9 / (double) tsc_frequency));
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <runner/statistics.h>
+
+/* Fixed-point scale of the ratio of core cycles to TSC ticks */
+#define FREQUENCY_RATIO_SCALE 1000000
+
+/* Default maximum spread of the effective frequency before a measurement is retried and flagged */
+#define DEFAULT_MAX_FREQUENCY_DRIFT 0.05
+
+struct frequency_statistics {
+	/* Median ratio of core cycles to TSC ticks */
+	double ratio;
+	/* 10th percentile of the ratio */
+	double low_ratio;
+	/* 90th percentile of the ratio */
+	double high_ratio;
+	/* Spread between the 10th and 90th percentiles relative to the median */
+	double drift;
+	/* Number of samples the statistics were computed from */
+	size_t samples;
+};
+
+/**
+ * @brief Computes the ratio of core cycles to TSC ticks of one kernel call, less measurement overhead.
+ * @return Ratio scaled by FREQUENCY_RATIO_SCALE, or 0 if the call was too short to tell.
+ */
+static inline unsigned long long compute_frequency_ratio(unsigned long long cycles, unsigned long long cycles_overhead,
+	unsigned long long tsc_ticks, unsigned long long tsc_overhead)
+{
+	if (cycles <= cycles_overhead || tsc_ticks <= tsc_overhead) {
+		return 0;
+	}
+	return (cycles - cycles_overhead) * FREQUENCY_RATIO_SCALE / (tsc_ticks - tsc_overhead);
+}
+
+/**
+ * @brief Computes the effective frequency and its drift from the sampled ratios of core cycles to TSC ticks.
+ * @param[in, out] accumulator Accumulated ratios scaled by FREQUENCY_RATIO_SCALE. The reservoir is reordered.
+ * @param[out]     statistics  Median, percentiles and drift of the ratio.
+ * @return true if the accumulator had any samples, false otherwise.
+ */
+bool summarize_frequency(struct sample_accumulator accumulator[restrict static 1],
+	struct frequency_statistics statistics[restrict static 1]);
+
+/**
+ * @brief Writes the effective frequency to the connection socket, and a warning if it drifted above the threshold.
+ * @param[in] statistics    Statistics of the ratio of core cycles to TSC ticks.
+ * @param[in] tsc_frequency TSC frequency in Hz, or 0 if unknown.
+ * @param[in] max_drift     Maximum spread of the frequency relative to its median.
+ * @param[in] retries       Number of times the measurement was repeated because of frequency drift.
+ */
+void report_frequency(int connection_socket, const struct frequency_statistics statistics[restrict static 1],
+	uint64_t tsc_frequency, double max_drift, size_t retries);
+
+/**
+ * @brief Writes the cycles and time per kernel call at the nominal (TSC) frequency to the connection socket.
+ */
+void report_nominal_timing(int connection_socket, unsigned long long tsc_ticks,
+	const struct measurement_statistics statistics[restrict static 1], uint64_t tsc_frequency);
@@ -82,7 +82,7 @@ static void check_image_header(const Elf64_Ehdr* elf_header, size_t image_size)
 	}
 }
 
-generic_function load_kernel(const void* elf_image, size_t image_size, const char* function_name) {
+generic_function load_kernel(const void* elf_image, size_t image_size, const char* function_name, size_t code_size[restrict static 1]) {
 	if (image_size < sizeof(Elf64_Ehdr)) {
 		log_fatal("invalid ELF image size: %zu\n", image_size);
 	}
@@ -137,5 +137,6 @@ generic_function load_kernel(const void* elf_image, size_t image_size, const cha
 		log_fatal("could not make the code segment executable: %s\n", strerror(errno));
 	}
 
+	*code_size = text_section->sh_size;
 	return (generic_function) text_segment;
 }
@@ -1,6 +1,9 @@
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
+#include <inttypes.h>
+#include <strings.h>
 
 #include <unistd.h>
 #include <sys/syscall.h>
@@ -11,17 +14,19 @@
 
 #include <cpuid.h>
 
+#include <webserver/logs.h>
 #include "perfctr.h"
 
 #define COUNT_OF(x) (sizeof(x) / sizeof(x[0]))
 
-struct x86_cpu_info {
-	uint32_t display_model;
-	uint32_t display_family;
-};
-
 struct x86_cpu_info get_x86_cpu_info(void) {
 	uint32_t eax, ebx, ecx, edx;
+	struct x86_cpu_info cpu_info = { 0 };
+	__cpuid(0, eax, ebx, ecx, edx);
+	memcpy(&cpu_info.vendor[0], &ebx, sizeof(ebx));
+	memcpy(&cpu_info.vendor[4], &edx, sizeof(edx));
+	memcpy(&cpu_info.vendor[8], &ecx, sizeof(ecx));
+
 	__cpuid(1, eax, ebx, ecx, edx);
 	const uint32_t model = (eax >> 4) & 0xF;
 	const uint32_t family = (eax >> 8) & 0xF;
@@ -35,20 +40,95 @@ struct x86_cpu_info get_x86_cpu_info(void) {
 	if ((family == 0x6) || (family == 0xF)) {
 		display_model += extended_model << 4;
 	}
-	return (struct x86_cpu_info) {
-		.display_model = display_model,
-		.display_family = display_family
-	};
+	cpu_info.display_model = display_model;
+	cpu_info.display_family = display_family;
+	cpu_info.stepping = eax & 0xF;
+	return cpu_info;
 }
 
-struct performance_counter_specification {
-	const char* name;
-	uint8_t event;
-	uint8_t umask;
-	uint8_t inv;
-	uint8_t cmask;
-	uint8_t edge;
-};
+struct x86_cache_info get_x86_cache_info(void) {
+	uint32_t max_leaf, eax, ebx, ecx, edx;
+	__cpuid(0, max_leaf, ebx, ecx, edx);
+	uint32_t cache_leaf = 0;
+	/* "GenuineIntel" */
+	if (ebx == UINT32_C(0x756E6547) && edx == UINT32_C(0x49656E69) && ecx == UINT32_C(0x6C65746E)) {
+		if (max_leaf >= 4) {
+			cache_leaf = 4;
+		}
+	}
+	/* "AuthenticAMD" */
+	if (ebx == UINT32_C(0x68747541) && edx == UINT32_C(0x69746E65) && ecx == UINT32_C(0x444D4163)) {
+		uint32_t max_extended_leaf;
+		__cpuid(0x80000000, max_extended_leaf, ebx, ecx, edx);
+		if (max_extended_leaf >= 0x8000001D) {
+			/* Leaf 0x80000001: ECX bit 22 indicates topology extensions, which include leaf 0x8000001D */
+			__cpuid(0x80000001, eax, ebx, ecx, edx);
+			if (ecx & (UINT32_C(1) << 22)) {
+				cache_leaf = 0x8000001D;
+			}
+		}
+	}
+
+	struct x86_cache_info cache_info = { 0 };
+	if (cache_leaf == 0) {
+		return cache_info;
+	}
+	/* Both leaves use the same layout, with one sub-leaf per cache, and a cache of type 0 after the last one */
+	for (uint32_t subleaf = 0; cache_info.count < MAX_CACHE_LEVELS; subleaf++) {
+		__cpuid_count(cache_leaf, subleaf, eax, ebx, ecx, edx);
+		const uint32_t type = eax & 0x1F;
+		if (type == 0) {
+			break;
+		}
+		/* Type 2 is an instruction cache */
+		if (type == 2) {
+			continue;
+		}
+		const size_t ways = ((ebx >> 22) & 0x3FF) + 1;
+		const size_t partitions = ((ebx >> 12) & 0x3FF) + 1;
+		const size_t line_size = (ebx & 0xFFF) + 1;
+		const size_t sets = (size_t) ecx + 1;
+		cache_info.levels[cache_info.count++] = (struct x86_cache_level) {
+			.level = (eax >> 5) & 0x7,
+			.size = ways * partitions * line_size * sets,
+		};
+	}
+	return cache_info;
+}
+
+struct x86_pmu_info get_x86_pmu_info(void) {
+	uint32_t max_leaf, ebx, ecx, edx;
+	__cpuid(0, max_leaf, ebx, ecx, edx);
+	/* "GenuineIntel" */
+	if (ebx == UINT32_C(0x756E6547) && edx == UINT32_C(0x49656E69) && ecx == UINT32_C(0x6C65746E)) {
+		if (max_leaf >= 0xA) {
+			uint32_t eax;
+			__cpuid(0xA, eax, ebx, ecx, edx);
+			const uint32_t version = eax & 0xFF;
+			if (version != 0) {
+				return (struct x86_pmu_info) {
+					.general_purpose_counters = (eax >> 8) & 0xFF,
+					.fixed_counters = version >= 2 ? edx & 0x1F : 0
+				};
+			}
+		}
+		return (struct x86_pmu_info) { 0 };
+	}
+	/* "AuthenticAMD" */
+	if (ebx == UINT32_C(0x68747541) && edx == UINT32_C(0x69746E65) && ecx == UINT32_C(0x444D4163)) {
+		uint32_t max_extended_leaf, eax;
+		__cpuid(0x80000000, max_extended_leaf, ebx, ecx, edx);
+		if (max_extended_leaf >= 0x80000001) {
+			__cpuid(0x80000001, eax, ebx, ecx, edx);
+			/* PerfCtrExtCore: six core performance counters */
+			if (ecx & (UINT32_C(1) << 23)) {
+				return (struct x86_pmu_info) { .general_purpose_counters = 6 };
+			}
+		}
+		return (struct x86_pmu_info) { .general_purpose_counters = 4 };
+	}
+	return (struct x86_pmu_info) { 0 };
+}
 
 // DisplayFamily_DisplayModel == 06_3DH or 06_47H
 const struct performance_counter_specification broadwell_specification[] = {
@@ -60,6 +140,7 @@ const struct performance_counter_specification broadwell_specification[] = {
 	{ .name = "UOPS_ISSUED.FLAGS_MERGE", .event = 0x0E, .umask = 0x10 },
 	{ .name = "UOPS_ISSUED.SLOW_LEA", .event = 0x0E, .umask = 0x20 },
 	{ .name = "UOPS_ISSUED.SINGLE_MUL", .event = 0x0E, .umask = 0x40 },
+	{ .name = "INT_MISC.RECOVERY_CYCLES", .event = 0x0D, .umask = 0x03, .cmask = 1 },
 	{ .name = "ARITH.FPU_DIV_ACTIVE", .event = 0x14, .umask = 0x01 },
 	{ .name = "L1D.REPLACEMENT", .event = 0x51, .umask = 0x01 },
 	{ .name = "MOVE_ELIMINATION.INT_NOT_ELIMINATED", .event = 0x58, .umask = 0x04 },
@@ -81,6 +162,7 @@ const struct performance_counter_specification broadwell_specification[] = {
 	{ .name = "ICACHE.MISSES", .event = 0x80, .umask = 0x02 },
 	{ .name = "ILD_STALL.LCP", .event = 0x87, .umask = 0x01 },
 	{ .name = "IDQ_UOPS_NOT_DELIVERED.CORE", .event = 0x9C, .umask = 0x01 },
+	{ .name = "IDQ_UOPS_NOT_DELIVERED.CYCLES_0_UOPS_DELIV.CORE", .event = 0x9C, .umask = 0x01, .cmask = 4 },
 	{ .name = "UOPS_DISPATCHED_PORT.PORT_0", .event = 0xA1, .umask = 0x01 },
 	{ .name = "UOPS_DISPATCHED_PORT.PORT_1", .event = 0xA1, .umask = 0x02 },
 	{ .name = "UOPS_DISPATCHED_PORT.PORT_2", .event = 0xA1, .umask = 0x04 },
@@ -93,6 +175,8 @@ const struct performance_counter_specification broadwell_specification[] = {
 	{ .name = "RESOURCE_STALLS.RS", .event = 0xA2, .umask = 0x04 },
 	{ .name = "RESOURCE_STALLS.SB", .event = 0xA2, .umask = 0x08 },
 	{ .name = "RESOURCE_STALLS.ROB", .event = 0xA2, .umask = 0x10 },
+	{ .name = "CYCLE_ACTIVITY.CYCLES_NO_EXECUTE", .event = 0xA3, .umask = 0x04, .cmask = 4 },
+	{ .name = "CYCLE_ACTIVITY.STALLS_LDM_PENDING", .event = 0xA3, .umask = 0x06, .cmask = 6 },
 	{ .name = "LSD.UOPS", .event = 0xA8, .umask = 0x01 },
 	{ .name = "DSB2MITE_SWITCHES.PENALTY_CYCLES", .event = 0xAB, .umask = 0x02 },
 	{ .name = "UOPS_EXECUTED.THREAD", .event = 0xB1, .umask = 0x01 },
@@ -105,6 +189,8 @@ const struct performance_counter_specification broadwell_specification[] = {
 	{ .name = "UOPS_RETIRED.ALL", .event = 0xC2, .umask = 0x01 },
 	{ .name = "UOPS_RETIRED.ALL.STALLS", .event = 0xC2, .umask = 0x01, .cmask = 1, .inv = 1 },
 	{ .name = "UOPS_RETIRED.RETIRE_SLOTS", .event = 0xC2, .umask = 0x02 },
+	{ .name = "MACHINE_CLEARS.COUNT", .event = 0xC3, .umask = 0x01, .cmask = 1, .edge = 1 },
+	{ .name = "BR_MISP_RETIRED.ALL_BRANCHES", .event = 0xC5, .umask = 0x00 },
 	{ .name = "FP_ASSIST.X87_OUTPUT", .event = 0xCA, .umask = 0x02 },
 	{ .name = "FP_ASSIST.X87_INPUT", .event = 0xCA, .umask = 0x04 },
 	{ .name = "FP_ASSIST.SIMD_OUTPUT", .event = 0xCA, .umask = 0x08 },
@@ -131,6 +217,8 @@ const struct performance_counter_specification haswell_specification[] = {
 	{ .name = "RESOURCE_STALLS.RS", .event = 0xA2, .umask = 0x04 },
 	{ .name = "RESOURCE_STALLS.SB", .event = 0xA2, .umask = 0x08 },
 	{ .name = "RESOURCE_STALLS.ROB", .event = 0xA2, .umask = 0x10 },
+	{ .name = "CYCLE_ACTIVITY.CYCLES_NO_EXECUTE", .event = 0xA3, .umask = 0x04, .cmask = 4 },
+	{ .name = "CYCLE_ACTIVITY.STALLS_LDM_PENDING", .event = 0xA3, .umask = 0x06, .cmask = 6 },
 	{ .name = "OTHER_ASSISTS.AVX_TO_SSE", .event = 0xC1, .umask = 0x08 },
 	{ .name = "OTHER_ASSISTS.SSE_TO_AVX", .event = 0xC1, .umask = 0x10 },
 	{ .name = "OTHER_ASSISTS.ANY_WB_ASSIST", .event = 0xC1, .umask = 0x40 },
@@ -138,12 +226,15 @@ const struct performance_counter_specification haswell_specification[] = {
 	{ .name = "UOPS_RETIRED.ALL.STALLS", .event = 0xC2, .umask = 0x01, .cmask = 1, .inv = 1 },
 	{ .name = "UOPS_RETIRED.ALL.ACTIVE", .event = 0xC2, .umask = 0x01, .cmask = 1 },
 	{ .name = "UOPS_RETIRED.RETIRE_SLOTS", .event = 0xC2, .umask = 0x02 },
+	{ .name = "MACHINE_CLEARS.COUNT", .event = 0xC3, .umask = 0x01, .cmask = 1, .edge = 1 },
+	{ .name = "BR_MISP_RETIRED.ALL_BRANCHES", .event = 0xC5, .umask = 0x00 },
 	{ .name = "LSD.UOPS", .event = 0xA8, .umask = 0x01 },
 	{ .name = "UOPS_ISSUED.ANY", .event = 0x0E, .umask = 0x01 },
 	{ .name = "UOPS_ISSUED.STALLS", .event = 0x0E, .umask = 0x01, .cmask = 1, .inv = 1 },
 	{ .name = "UOPS_ISSUED.FLAGS_MERGE", .event = 0x0E, .umask = 0x10 },
 	{ .name = "UOPS_ISSUED.SLOW_LEA", .event = 0x0E, .umask = 0x20 },
 	{ .name = "UOPS_ISSUED.SINGLE_MUL", .event = 0x0E, .umask = 0x40 },
+	{ .name = "INT_MISC.RECOVERY_CYCLES", .event = 0x0D, .umask = 0x03, .cmask = 1 },
 	{ .name = "IDQ.EMPTY", .event = 0x79, .umask = 0x02 },
 	{ .name = "IDQ.MITE_UOPS", .event = 0x79, .umask = 0x04 },
 	{ .name = "IDQ.DSB_UOPS", .event = 0x79, .umask = 0x08 },
@@ -158,9 +249,30 @@ const struct performance_counter_specification haswell_specification[] = {
 	{ .name = "ICACHE.MISSES", .event = 0x80, .umask = 0x02 },
 	{ .name = "ILD_STALL.LCP", .event = 0x87, .umask = 0x01 },
 	{ .name = "ILD_STALL.IQ_FULL", .event = 0x87, .umask = 0x04 },
+	{ .name = "IDQ_UOPS_NOT_DELIVERED.CORE", .event = 0x9C, .umask = 0x01 },
+	{ .name = "IDQ_UOPS_NOT_DELIVERED.CYCLES_0_UOPS_DELIV.CORE", .event = 0x9C, .umask = 0x01, .cmask = 4 },
 	{ .name = "RS_EVENTS.EMPTY_CYCLES", .event = 0x5E, .umask = 0x01 },
 };
 
+// Haswell and Broadwell share the top-down analysis formulas and events
+static const struct tma_specification haswell_tma_specification = {
+	.pipeline_width = 4,
+	.events = {
+		[tma_event_cycles] = "Cycles",
+		[tma_event_uops_issued] = "UOPS_ISSUED.ANY",
+		[tma_event_retire_slots] = "UOPS_RETIRED.RETIRE_SLOTS",
+		[tma_event_recovery_cycles] = "INT_MISC.RECOVERY_CYCLES",
+		[tma_event_undelivered_uops] = "IDQ_UOPS_NOT_DELIVERED.CORE",
+		[tma_event_undelivered_cycles] = "IDQ_UOPS_NOT_DELIVERED.CYCLES_0_UOPS_DELIV.CORE",
+		[tma_event_microcode_uops] = "IDQ.MS_UOPS",
+		[tma_event_branch_mispredicts] = "BR_MISP_RETIRED.ALL_BRANCHES",
+		[tma_event_machine_clears] = "MACHINE_CLEARS.COUNT",
+		[tma_event_execution_stalls] = "CYCLE_ACTIVITY.CYCLES_NO_EXECUTE",
+		[tma_event_memory_stalls] = "CYCLE_ACTIVITY.STALLS_LDM_PENDING",
+		[tma_event_store_buffer_stalls] = "RESOURCE_STALLS.SB",
+	},
+};
+
 // DisplayFamily_DisplayModel == 06_3AH
 const struct performance_counter_specification ivybridge_specification[] = {
 	{ .name = "UOPS_ISSUED.ANY", .event = 0x0E, .umask = 0x01 },
@@ -287,9 +399,9 @@ const struct performance_counter_specification steamroller_specification[] = {
 	{ .name = "RETIRED_SSEAVX_FLOPS.DP_MUL", .event = 0x03, .umask = 0x20 },
 	{ .name = "RETIRED_SSEAVX_FLOPS.DP_DIVSQRT", .event = 0x03, .umask = 0x40 },
 	{ .name = "RETIRED_SSEAVX_FLOPS.DP_FMA", .event = 0x03, .umask = 0x80 },
-	// { .name = "RETIRED_X87_FLOPS.ADDSUB", .event = 0x1C0, .umask = 0x01 },
-	// { .name = "RETIRED_X87_FLOPS.MUL", .event = 0x1C0, .umask = 0x02 },
-	// { .name = "RETIRED_X87_FLOPS.DIVSQRT", .event = 0x1C0, .umask = 0x04 },
+	{ .name = "RETIRED_X87_FLOPS.ADDSUB", .event = 0x1C0, .umask = 0x01 },
+	{ .name = "RETIRED_X87_FLOPS.MUL", .event = 0x1C0, .umask = 0x02 },
+	{ .name = "RETIRED_X87_FLOPS.DIVSQRT", .event = 0x1C0, .umask = 0x04 },
 	{ .name = "MOVE_OPTIMIZATION.SSE_MOVE_OPS.ALL", .event = 0x04, .umask = 0x01 },
 	{ .name = "MOVE_OPTIMIZATION.SSE_MOVE_OPS.ELIMINATED", .event = 0x04, .umask = 0x02 },
 	{ .name = "MOVE_OPTIMIZATION.SCALAR_CANDIDATE_OPS.ALL", .event = 0x04, .umask = 0x04 },
@@ -410,96 +522,394 @@ static int perf_event_open(struct perf_event_attr *hw_event, pid_t pid, int cpu,
 	return syscall(__NR_perf_event_open, hw_event, pid, cpu, group_fd, flags);
 }
 
-int open_performance_counter(enum perf_type_id type, uint64_t config) {
+int open_performance_counter(uint32_t type, uint64_t config, int group_fd) {
 	struct perf_event_attr perf_event_attr;
 	memset(&perf_event_attr, 0, sizeof(perf_event_attr));
 	perf_event_attr.type = type;
 	perf_event_attr.size = sizeof(perf_event_attr);
 	perf_event_attr.config = config;
-	perf_event_attr.disabled = 1;
+	perf_event_attr.disabled = group_fd == -1;
 	perf_event_attr.exclude_kernel = 1;
 	perf_event_attr.exclude_hv = 1;
-	return perf_event_open(&perf_event_attr, 0, -1, -1, 0);
+	perf_event_attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+	return perf_event_open(&perf_event_attr, 0, -1, group_fd, 0);
 }
 
-struct performance_counters init_performance_counters(void) {
-	size_t generic_count = 2;
-	const struct performance_counter_specification* model_specification = NULL;
-	size_t model_count = 0;
-	struct x86_cpu_info cpu_info = get_x86_cpu_info();
-	if (cpu_info.display_family == 0x06) {
-		switch (cpu_info.display_model) {
+/*
+ * @brief Opens performance counters in a group, and checks that the PMU can schedule all of them at the same time.
+ * @details Counters which the kernel refuses to open are removed from the group. If the PMU can not schedule the group
+ *          (e.g. because some counters are taken by the NMI watchdog), the group is split in two, and the second half
+ *          is appended to the list of groups.
+ * @param[in, out] performance_counters Performance counters with the groups array.
+ * @param[in]      group_index          Index of the group to open.
+ */
+static void open_performance_counter_group(struct performance_counters performance_counters[restrict static 1], size_t group_index) {
+	struct performance_counter_group* group = &performance_counters->groups[group_index];
+	struct performance_counter* counters = performance_counters->counters;
+	size_t opened_count = 0;
+	for (size_t i = 0; i < group->count; i++) {
+		struct performance_counter* counter = &counters[group->counter_index[i]];
+		counter->file_descriptor = open_performance_counter(counter->type, counter->config, group->file_descriptor);
+		if (counter->file_descriptor != -1) {
+			if (group->file_descriptor == -1) {
+				group->file_descriptor = counter->file_descriptor;
+			}
+			group->counter_index[opened_count++] = group->counter_index[i];
+		}
+	}
+	group->count = opened_count;
+	if (group->count <= 1) {
+		return;
+	}
+
+	struct performance_counter_group_values values;
+	ioctl(group->file_descriptor, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	const ssize_t bytes_read = read(group->file_descriptor, &values, sizeof(values));
+	ioctl(group->file_descriptor, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+	if (bytes_read > 0 && values.time_running != 0) {
+		return;
+	}
+
+	/* The group can not be scheduled: split it in halves and retry */
+	for (size_t i = 0; i < group->count; i++) {
+		close(counters[group->counter_index[i]].file_descriptor);
+		counters[group->counter_index[i]].file_descriptor = -1;
+	}
+	struct performance_counter_group* split_group = &performance_counters->groups[performance_counters->group_count++];
+	split_group->file_descriptor = -1;
+	split_group->count = group->count / 2;
+	group->count -= split_group->count;
+	memcpy(split_group->counter_index, &group->counter_index[group->count], split_group->count * sizeof(size_t));
+	group->file_descriptor = -1;
+	open_performance_counter_group(performance_counters, group_index);
+}
+
+static struct performance_event_table event_table = {
+	.name = "generic",
+};
+
+static struct performance_event_table select_builtin_event_table(const struct x86_cpu_info cpu_info[restrict static 1]) {
+	if (cpu_info->display_family == 0x06) {
+		switch (cpu_info->display_model) {
 			case 0x3D:
 			case 0x47:
 				/* Broadwell */
-				model_specification = broadwell_specification;
-				model_count = COUNT_OF(broadwell_specification);
-				break;
+				return (struct performance_event_table) {
+					.name = "Broadwell",
+					.events = broadwell_specification,
+					.count = COUNT_OF(broadwell_specification)
+				};
 			case 0x3C:
 			case 0x45:
 			case 0x46:
 				/* Haswell */
-				model_specification = haswell_specification;
-				model_count = COUNT_OF(haswell_specification);
-				break;
+				return (struct performance_event_table) {
+					.name = "Haswell",
+					.events = haswell_specification,
+					.count = COUNT_OF(haswell_specification)
+				};
 			case 0x3A:
 				/* Ivy Bridge */
-				model_specification = ivybridge_specification;
-				model_count = COUNT_OF(ivybridge_specification);
-				break;
+				return (struct performance_event_table) {
+					.name = "Ivy Bridge",
+					.events = ivybridge_specification,
+					.count = COUNT_OF(ivybridge_specification)
+				};
 			case 0x1C:
 			case 0x26:
 			case 0x27:
 			case 0x35:
 			case 0x36:
 				/* Atom */
-				model_specification = atom_specification;
-				model_count = COUNT_OF(atom_specification);
-				break;
+				return (struct performance_event_table) {
+					.name = "Atom",
+					.events = atom_specification,
+					.count = COUNT_OF(atom_specification)
+				};
 		}
 	}
-	if (cpu_info.display_family == 0x15) {
-		if ((cpu_info.display_model & ~0xF) == 0x00) {
+	if (cpu_info->display_family == 0x15) {
+		if ((cpu_info->display_model & ~0xF) == 0x00) {
 			/* Bulldozer */
-			model_specification = bulldozer_specification;
-			model_count = COUNT_OF(bulldozer_specification);
-		} else if ((cpu_info.display_model & ~0xF) == 0x30) {
+			return (struct performance_event_table) {
+				.name = "Bulldozer",
+				.events = bulldozer_specification,
+				.count = COUNT_OF(bulldozer_specification)
+			};
+		} else if ((cpu_info->display_model & ~0xF) == 0x30) {
 			/* Steamroller */
-			model_specification = steamroller_specification;
-			model_count = COUNT_OF(steamroller_specification);
+			return (struct performance_event_table) {
+				.name = "Steamroller",
+				.events = steamroller_specification,
+				.count = COUNT_OF(steamroller_specification)
+			};
 		}
 	}
-	if (cpu_info.display_family == 0x14) {
-		if ((cpu_info.display_model & ~0xF) == 0x00) {
+	if (cpu_info->display_family == 0x14) {
+		if ((cpu_info->display_model & ~0xF) == 0x00) {
 			/* Bobcat */
-			model_specification = bobcat_specification;
-			model_count = COUNT_OF(bobcat_specification);
+			return (struct performance_event_table) {
+				.name = "Bobcat",
+				.events = bobcat_specification,
+				.count = COUNT_OF(bobcat_specification)
+			};
 		}
 	}
+	return (struct performance_event_table) {
+		.name = "generic",
+	};
+}
+
+static const struct tma_specification* select_tma_specification(const struct x86_cpu_info cpu_info[restrict static 1]) {
+	if (cpu_info->display_family == 0x06) {
+		switch (cpu_info->display_model) {
+			case 0x3D:
+			case 0x47:
+				/* Broadwell */
+			case 0x3C:
+			case 0x45:
+			case 0x46:
+				/* Haswell */
+				return &haswell_tma_specification;
+		}
+	}
+	return NULL;
+}
+
+const struct performance_event_table* init_performance_event_table(const char* events_directory) {
+	const struct x86_cpu_info cpu_info = get_x86_cpu_info();
+	if (events_directory != NULL) {
+		if (load_perfmon_event_table(events_directory, &cpu_info, &event_table)) {
+			event_table.tma = select_tma_specification(&cpu_info);
+			return &event_table;
+		}
+		log_error("no event file for %s-%"PRIu32"-%02"PRIX32"-%"PRIX32" in %s: falling back to built-in event tables\n",
+			cpu_info.vendor, cpu_info.display_family, cpu_info.display_model, cpu_info.stepping, events_directory);
+	}
+	event_table = select_builtin_event_table(&cpu_info);
+	event_table.tma = select_tma_specification(&cpu_info);
+	return &event_table;
+}
+
+static const char* memory_event_prefixes[] = {
+	"L1D", "L2_", "LLC", "LONGEST_LAT", "MEM_", "LD_", "LOAD_", "STORE", "DTLB", "DATA_TLB", "PAGE_WALK", "MISALIGN",
+	"LS_", "STLD_", "OFFCORE", "CYCLE_ACTIVITY", "PREFETCH", "SQ_MISC", "SW_PREFETCH",
+};
+
+static const char* frontend_event_prefixes[] = {
+	"IDQ", "ICACHE", "ILD_", "DSB", "ITLB", "DECODE", "INSTRUCTION_FETCH", "BACLEARS", "LSD.", "FRONTEND", "MACRO_INSTS",
+};
+
+static bool has_prefix(const char* name, size_t prefix_count, const char* prefixes[restrict static prefix_count]) {
+	for (size_t i = 0; i < prefix_count; i++) {
+		if (strncmp(name, prefixes[i], strlen(prefixes[i])) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool is_tma_event(const char* name) {
+	if (event_table.tma != NULL) {
+		for (size_t i = 0; i < tma_event_count; i++) {
+			if (strcmp(name, event_table.tma->events[i]) == 0) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+static enum performance_counter_category classify_model_event(const char* name) {
+	if (has_prefix(name, COUNT_OF(memory_event_prefixes), memory_event_prefixes)) {
+		return performance_counter_category_memory;
+	} else if (has_prefix(name, COUNT_OF(frontend_event_prefixes), frontend_event_prefixes)) {
+		return performance_counter_category_frontend;
+	} else {
+		return performance_counter_category_other;
+	}
+}
+
+/*
+ * @brief Marks the counters requested by a comma-separated list of event names and event sets.
+ * @details Event names are matched case-insensitively. Unknown names, sets without events in the active event table,
+ *          and lists which select no events terminate the request.
+ */
+static void select_performance_counters(size_t events_size, const char events[restrict static events_size],
+	size_t count, const struct performance_counter counters[restrict static count], bool selected[restrict static count])
+{
+	const char* events_end = &events[events_size];
+	const char* event = events;
+	bool any_found = false;
+	while (event != events_end) {
+		const char* event_end = memchr(event, ',', events_end - event);
+		if (event_end == NULL) {
+			event_end = events_end;
+		}
+		const size_t event_size = event_end - event;
+
+		bool is_set = true;
+		bool select_all = false;
+		bool select_tma = false;
+		enum performance_counter_category category = performance_counter_category_other;
+		if (event_size == sizeof("all") - 1 && strncasecmp(event, "all", event_size) == 0) {
+			select_all = true;
+		} else if (event_size == sizeof("basic") - 1 && strncasecmp(event, "basic", event_size) == 0) {
+			category = performance_counter_category_basic;
+		} else if (event_size == sizeof("memory") - 1 && strncasecmp(event, "memory", event_size) == 0) {
+			category = performance_counter_category_memory;
+		} else if (event_size == sizeof("frontend") - 1 && strncasecmp(event, "frontend", event_size) == 0) {
+			category = performance_counter_category_frontend;
+		} else if (event_size == sizeof("tma") - 1 && strncasecmp(event, "tma", event_size) == 0) {
+			if (event_table.tma == NULL) {
+				log_fatal("top-down analysis is not supported for %s event table\n", event_table.name);
+			}
+			select_tma = true;
+		} else {
+			is_set = false;
+		}
+
+		bool found = false;
+		for (size_t i = 0; i < count; i++) {
+			bool matches;
+			if (select_tma) {
+				matches = is_tma_event(counters[i].name);
+			} else if (is_set) {
+				matches = select_all || counters[i].category == category;
+			} else {
+				matches = strlen(counters[i].name) == event_size && strncasecmp(counters[i].name, event, event_size) == 0;
+			}
+			if (matches) {
+				selected[i] = true;
+				found = true;
+			}
+		}
+		if (!found) {
+			if (is_set) {
+				log_fatal("event set %.*s has no events in %s event table\n", (int) event_size, event, event_table.name);
+			}
+			log_fatal("unknown event %.*s\n", (int) event_size, event);
+		}
+		any_found = true;
+
+		event = event_end == events_end ? events_end : event_end + 1;
+	}
+	if (!any_found) {
+		log_fatal("event list selects no events in %s event table\n", event_table.name);
+	}
+}
+
+struct performance_counter* create_performance_counters(size_t events_size, const char* events, size_t count_out[restrict static 1]) {
+	const size_t generic_count = 2;
+	const struct performance_counter_specification* model_specification = event_table.events;
+	const size_t model_count = event_table.count;
+	struct x86_pmu_info pmu_info = get_x86_pmu_info();
+	/* If CPUID does not describe the PMU, assume the two counters available on all x86 CPUs with performance monitoring */
+	if (pmu_info.general_purpose_counters == 0) {
+		pmu_info.general_purpose_counters = 2;
+	}
+	const uint64_t general_purpose_mask = (UINT64_C(1) << pmu_info.general_purpose_counters) - 1;
+
 	struct performance_counter* performance_counters =
 		(struct performance_counter*) malloc((generic_count + model_count) * sizeof(struct performance_counter));
 	performance_counters[0] = (struct performance_counter) {
 		.name = "Cycles",
-		.file_descriptor = open_performance_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES)
+		.category = performance_counter_category_basic,
+		.file_descriptor = -1,
+		.type = PERF_TYPE_HARDWARE,
+		.config = PERF_COUNT_HW_CPU_CYCLES,
+		/* CPU_CLK_UNHALTED.CORE is fixed-function counter 1 */
+		.counter_mask = general_purpose_mask | (pmu_info.fixed_counters > 1 ? FIXED_COUNTER_MASK(1) : 0)
 	};
 	performance_counters[1] = (struct performance_counter) {
 		.name = "Instructions",
-		.file_descriptor = open_performance_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS)
+		.category = performance_counter_category_basic,
+		.file_descriptor = -1,
+		.type = PERF_TYPE_HARDWARE,
+		.config = PERF_COUNT_HW_INSTRUCTIONS,
+		/* INST_RETIRED.ANY is fixed-function counter 0 */
+		.counter_mask = general_purpose_mask | (pmu_info.fixed_counters > 0 ? FIXED_COUNTER_MASK(0) : 0)
 	};
 	for (size_t i = 0; i < model_count; i++) {
-		const uint64_t config = ((uint32_t) model_specification[i].event) |
+		/* AMD keeps EventSelect[11:8] in bits 35:32 of PERF_CTL, where the raw perf_event config expects it too */
+		const uint64_t config = ((uint32_t) model_specification[i].event & 0xFF) |
+			(((uint64_t) model_specification[i].event & 0xF00) << 24) |
 			(((uint32_t) model_specification[i].umask) << 8) |
 			(((uint32_t) model_specification[i].edge) << 18) |
 			(((uint32_t) model_specification[i].inv) << 23) |
 			(((uint32_t) model_specification[i].cmask) << 24);
 
+		uint64_t counter_mask = general_purpose_mask;
+		if (model_specification[i].counters != 0) {
+			counter_mask &= model_specification[i].counters;
+		}
 		performance_counters[generic_count + i] = (struct performance_counter) {
 			.name = model_specification[i].name,
-			.file_descriptor = open_performance_counter(PERF_TYPE_RAW, config)
+			.category = classify_model_event(model_specification[i].name),
+			.file_descriptor = -1,
+			.type = PERF_TYPE_RAW,
+			.config = config,
+			.counter_mask = counter_mask,
+			.exclusive = model_specification[i].exclusive
 		};
 	}
-	return (struct performance_counters) {
+	size_t count = generic_count + model_count;
+
+	if (events != NULL) {
+		bool selected[count];
+		memset(selected, 0, sizeof(selected));
+		select_performance_counters(events_size, events, count, performance_counters, selected);
+		size_t selected_count = 0;
+		for (size_t i = 0; i < count; i++) {
+			if (selected[i]) {
+				performance_counters[selected_count++] = performance_counters[i];
+			}
+		}
+		count = selected_count;
+	}
+	*count_out = count;
+	return performance_counters;
+}
+
+struct performance_counters init_performance_counters(size_t events_size, const char* events) {
+	size_t count = 0;
+	struct performance_counter* performance_counters = create_performance_counters(events_size, events, &count);
+
+	/* Each split while opening the groups adds one group, and there can be at most one group per counter */
+	struct performance_counter_group* groups =
+		(struct performance_counter_group*) malloc(count * sizeof(struct performance_counter_group));
+	struct performance_counters result = {
 		.counters = performance_counters,
-		.count = generic_count + model_count,
+		.count = count,
+		.groups = groups,
+		.group_count = plan_performance_counter_groups(count, performance_counters, groups),
+		.tma = event_table.tma,
 	};
+	for (size_t group_index = 0; group_index < result.group_count; group_index++) {
+		open_performance_counter_group(&result, group_index);
+	}
+	/* Groups are final only after all splits */
+	for (size_t group_index = 0; group_index < result.group_count; group_index++) {
+		struct performance_counter_group* group = &result.groups[group_index];
+		group->cycles_index = SIZE_MAX;
+		for (size_t i = 0; i < group->count; i++) {
+			const struct performance_counter* counter = &performance_counters[group->counter_index[i]];
+			if (counter->type == PERF_TYPE_HARDWARE && counter->config == PERF_COUNT_HW_CPU_CYCLES) {
+				group->cycles_index = i;
+				break;
+			}
+		}
+	}
+	return result;
+}
+
+void release_performance_counters(struct performance_counters performance_counters[restrict static 1]) {
+	for (size_t i = 0; i < performance_counters->count; i++) {
+		if (performance_counters->counters[i].file_descriptor != -1) {
+			close(performance_counters->counters[i].file_descriptor);
+		}
+	}
+	free(performance_counters->counters);
+	free(performance_counters->groups);
+	*performance_counters = (struct performance_counters) { 0 };
 }
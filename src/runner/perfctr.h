@@ -1,21 +1,256 @@
 #pragma once
 
 #include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
 
 #include <unistd.h>
 #include <sys/ioctl.h>
 #include <linux/perf_event.h>
 
+/* Maximum number of performance counters which can be scheduled together in one group */
+#define MAX_GROUP_COUNTERS 16
+
+/* Bits 0-31 of a counter mask correspond to general-purpose counters, bits 32-63 to fixed-function counters */
+#define FIXED_COUNTER_MASK(index) (UINT64_C(1) << (32 + (index)))
+
+struct x86_cpu_info {
+	char vendor[13];
+	uint32_t display_model;
+	uint32_t display_family;
+	uint32_t stepping;
+};
+
+struct x86_pmu_info {
+	uint32_t general_purpose_counters;
+	uint32_t fixed_counters;
+};
+
+/* Maximum number of data and unified caches CPUID describes */
+#define MAX_CACHE_LEVELS 4
+
+struct x86_cache_level {
+	/* Cache level, starting from 1 */
+	uint32_t level;
+	/* Size in bytes of the cache instance which serves one core */
+	size_t size;
+};
+
+struct x86_cache_info {
+	/* Data and unified caches, from the closest to the core; instruction caches are skipped */
+	struct x86_cache_level levels[MAX_CACHE_LEVELS];
+	size_t count;
+};
+
+struct x86_cpu_info get_x86_cpu_info(void);
+struct x86_pmu_info get_x86_pmu_info(void);
+
+/**
+ * @brief Describes the data cache hierarchy with the deterministic cache parameters of CPUID.
+ * @details Reads leaf 4 on Intel processors and leaf 0x8000001D on AMD processors with topology extensions.
+ * @return Cache levels, or no levels if the processor does not report them.
+ */
+struct x86_cache_info get_x86_cache_info(void);
+
+struct performance_counter_specification {
+	const char* name;
+	/* Event select; AMD processors use 12 bits, Intel processors 8 bits */
+	uint16_t event;
+	uint8_t umask;
+	uint8_t inv;
+	uint8_t cmask;
+	uint8_t edge;
+	/* Mask of general-purpose counters which can count the event; 0 if the event can use any counter */
+	uint8_t counters;
+	/* The event must be measured alone, without other events on general-purpose counters */
+	bool exclusive;
+};
+
+/* Roles of events in the formulas of the top-down microarchitecture analysis (TMA) */
+enum tma_event {
+	/* Unhalted core cycles */
+	tma_event_cycles,
+	/* Uops issued by the front-end into the back-end */
+	tma_event_uops_issued,
+	/* Issue slots used by retired uops */
+	tma_event_retire_slots,
+	/* Cycles the back-end spent recovering from mispredicts and machine clears */
+	tma_event_recovery_cycles,
+	/* Issue slots not filled by the front-end while the back-end was not stalled */
+	tma_event_undelivered_uops,
+	/* Cycles the front-end delivered no uops while the back-end was not stalled */
+	tma_event_undelivered_cycles,
+	/* Uops delivered by the microcode sequencer */
+	tma_event_microcode_uops,
+	/* Retired mispredicted branches */
+	tma_event_branch_mispredicts,
+	/* Machine clears (memory ordering, self-modifying code, etc) */
+	tma_event_machine_clears,
+	/* Cycles no uops were executed */
+	tma_event_execution_stalls,
+	/* Execution stall cycles with a pending load */
+	tma_event_memory_stalls,
+	/* Cycles the back-end stalled because the store buffer was full */
+	tma_event_store_buffer_stalls,
+	tma_event_count,
+};
+
+struct tma_specification {
+	/* Number of issue slots per cycle */
+	uint32_t pipeline_width;
+	/* Names of the events which play each role in the formulas */
+	const char* events[tma_event_count];
+};
+
+struct performance_event_table {
+	const char* name;
+	const struct performance_counter_specification* events;
+	size_t count;
+	/* Top-down analysis formulas for the processor model, or NULL if the model is not supported */
+	const struct tma_specification* tma;
+};
+
+/**
+ * @brief Selects the table of model-specific events for the host processor.
+ * @details If @a events_directory is not NULL, the function first looks for an event file for the host processor in
+ *          this directory, and falls back to the built-in tables if no suitable file is found.
+ *          The selected table is used by all subsequent calls to init_performance_counters.
+ * @param[in] events_directory Path to a directory with JSON event files in perfmon format and a mapfile.csv index.
+ * @return The selected event table.
+ */
+const struct performance_event_table* init_performance_event_table(const char* events_directory);
+
+/**
+ * @brief Loads a table of events for the specified processor from a directory of perfmon JSON event files.
+ * @param[in]  events_directory Path to a directory with mapfile.csv and JSON event files referenced by it.
+ * @param[in]  cpu_info         Description of the processor to load event table for.
+ * @param[out] event_table      Loaded event table. The name and events are allocated with malloc.
+ * @return true if an event table for the processor was found and loaded, false otherwise.
+ */
+bool load_perfmon_event_table(const char* events_directory, const struct x86_cpu_info cpu_info[restrict static 1],
+	struct performance_event_table event_table[restrict static 1]);
+
+enum performance_counter_category {
+	performance_counter_category_basic,
+	performance_counter_category_memory,
+	performance_counter_category_frontend,
+	performance_counter_category_other,
+};
+
 struct performance_counter {
 	const char* name;
+	enum performance_counter_category category;
 	int file_descriptor;
+	uint32_t type;
+	uint64_t config;
+	/* Mask of hardware counters the event can be scheduled on */
+	uint64_t counter_mask;
+	/* The event can not share general-purpose counters with other events */
+	bool exclusive;
+};
+
+struct performance_counter_group {
+	/* File descriptor of the group leader, or -1 if no counter in the group could be opened */
+	int file_descriptor;
+	/* Indices of the group members in performance_counters.counters, in the order read() reports them */
+	size_t counter_index[MAX_GROUP_COUNTERS];
+	size_t count;
+	/* Position of the core cycles counter among the group members, or SIZE_MAX if the group does not count cycles */
+	size_t cycles_index;
+};
+
+/* Quantities sampled along with the members of every performance counter group, stored after the group members */
+enum group_quantity {
+	/* TSC ticks per kernel call, i.e. cycles at the nominal frequency */
+	group_quantity_tsc_ticks,
+	/* Ratio of core cycles to TSC ticks, scaled by FREQUENCY_RATIO_SCALE, if the group counts core cycles */
+	group_quantity_frequency_ratio,
+	group_quantity_count,
 };
 
 struct performance_counters {
 	struct performance_counter* counters;
 	size_t count;
+	struct performance_counter_group* groups;
+	size_t group_count;
+	/* Top-down analysis formulas of the active event table, or NULL */
+	const struct tma_specification* tma;
+};
+
+/* Layout of read() data for a group leader opened with PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING */
+struct performance_counter_group_values {
+	uint64_t count;
+	uint64_t time_enabled;
+	uint64_t time_running;
+	uint64_t values[MAX_GROUP_COUNTERS];
+};
+
+/**
+ * @brief Resolves a selection of events against the active event table.
+ * @param[in]  events_size Size of the @a events string.
+ * @param[in]  events      Comma-separated list of event names and event sets (basic, memory, frontend, tma, all) to measure.
+ *                         If NULL, all events in the event table are selected.
+ * @param[out] count       Number of selected events.
+ * @return Array of the selected performance counters, allocated with malloc. File descriptors are not opened.
+ */
+struct performance_counter* create_performance_counters(size_t events_size, const char* events, size_t count[restrict static 1]);
+
+/**
+ * @brief Opens the selected performance counters and packs them into groups.
+ * @param[in] events_size Size of the @a events string.
+ * @param[in] events      Comma-separated list of event names and event sets (basic, memory, frontend, tma, all) to measure.
+ *                        If NULL, all events in the event table are measured.
+ */
+struct performance_counters init_performance_counters(size_t events_size, const char* events);
+
+/**
+ * @brief Closes the file descriptors of performance counters and frees the arrays allocated by init_performance_counters.
+ */
+void release_performance_counters(struct performance_counters performance_counters[restrict static 1]);
+
+/**
+ * @brief Packs performance counters into groups such that all counters in a group can be scheduled on the PMU at the same time.
+ * @details The planner places the most constrained counters first and assigns each counter to the first group where
+ *          a matching of the group members to hardware counters still exists. This gives the minimal or close to
+ *          minimal number of groups, and thus of measurement passes.
+ * @param[in]  counter_count Number of performance counters to schedule.
+ * @param[in]  counters      Performance counters to schedule. Only the @a counter_mask and @a exclusive fields are used.
+ * @param[out] groups        Array of at least @a counter_count groups to receive the plan. File descriptors are not set.
+ * @return Number of groups in the plan.
+ */
+size_t plan_performance_counter_groups(size_t counter_count,
+	const struct performance_counter counters[restrict static counter_count],
+	struct performance_counter_group groups[restrict static counter_count]);
+
+/* Top-down analysis breakdown of issue slots. All values are fractions of the total number of issue slots. */
+struct tma_metrics {
+	/* Level 1 */
+	double frontend_bound;
+	double bad_speculation;
+	double retiring;
+	double backend_bound;
+	/* Level 2 */
+	double frontend_latency;
+	double frontend_bandwidth;
+	double branch_mispredicts;
+	double machine_clears;
+	double base;
+	double microcode_sequencer;
+	double memory_bound;
+	double core_bound;
 };
 
-struct performance_counters init_performance_counters(void);
+/**
+ * @brief Computes top-down analysis metrics from measured event counts.
+ * @param[in]  performance_counters Measured performance counters.
+ * @param[in]  counts               Counts of the performance counters, or ULLONG_MAX for counters which failed to measure.
+ * @param[out] metrics              Computed metrics.
+ * @return true if the event table has top-down analysis formulas and all events they need were measured, false otherwise.
+ */
+bool compute_tma_metrics(const struct performance_counters performance_counters[restrict static 1],
+	const unsigned long long counts[restrict static 1], struct tma_metrics metrics[restrict static 1]);
 
-unsigned long long median(unsigned long long array[], size_t length);
+/**
+ * @brief Writes top-down analysis metrics to the connection socket, one metric per line.
+ */
+void report_tma_metrics(int connection_socket, const struct tma_metrics metrics[restrict static 1]);
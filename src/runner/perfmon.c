@@ -0,0 +1,433 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include <errno.h>
+#include <limits.h>
+#include <regex.h>
+
+#include <webserver/logs.h>
+#include <runner/perfctr.h>
+
+/* Maximum length of a JSON string value relevant for event descriptions */
+#define MAX_FIELD_SIZE 256
+
+/*
+ * Minimal JSON reader for perfmon event files. Event files are either a top-level array of event objects (older
+ * releases), or an object with "Header" and "Events" members (newer releases). Event objects are flat dictionaries
+ * of string (or, in some files, numeric) values.
+ */
+struct json_reader {
+	const char* position;
+	const char* end;
+};
+
+static void skip_whitespace(struct json_reader reader[restrict static 1]) {
+	while (reader->position != reader->end) {
+		switch (*reader->position) {
+			case ' ':
+			case '\t':
+			case '\r':
+			case '\n':
+				reader->position++;
+				break;
+			default:
+				return;
+		}
+	}
+}
+
+static bool consume_character(struct json_reader reader[restrict static 1], char character) {
+	skip_whitespace(reader);
+	if (reader->position != reader->end && *reader->position == character) {
+		reader->position++;
+		return true;
+	}
+	return false;
+}
+
+/*
+ * @brief Reads a JSON string or a bare scalar (number, true, false, null) and copies its text into the buffer.
+ * @details Escape sequences are copied with the escaped character only: event fields never need \u escapes.
+ *          Values longer than the buffer are truncated.
+ */
+static bool read_scalar(struct json_reader reader[restrict static 1], char value[restrict static MAX_FIELD_SIZE]) {
+	skip_whitespace(reader);
+	size_t length = 0;
+	if (reader->position != reader->end && *reader->position == '"') {
+		reader->position++;
+		while (reader->position != reader->end && *reader->position != '"') {
+			if (*reader->position == '\\') {
+				reader->position++;
+				if (reader->position == reader->end) {
+					return false;
+				}
+			}
+			if (length + 1 < MAX_FIELD_SIZE) {
+				value[length++] = *reader->position;
+			}
+			reader->position++;
+		}
+		if (reader->position == reader->end) {
+			return false;
+		}
+		reader->position++;
+	} else {
+		while (reader->position != reader->end && strchr(",}] \t\r\n", *reader->position) == NULL) {
+			if (length + 1 < MAX_FIELD_SIZE) {
+				value[length++] = *reader->position;
+			}
+			reader->position++;
+		}
+		if (length == 0) {
+			return false;
+		}
+	}
+	value[length] = '\0';
+	return true;
+}
+
+static bool skip_value(struct json_reader reader[restrict static 1]) {
+	skip_whitespace(reader);
+	if (reader->position == reader->end) {
+		return false;
+	}
+	const char opening = *reader->position;
+	if (opening == '{' || opening == '[') {
+		const char closing = opening == '{' ? '}' : ']';
+		reader->position++;
+		if (consume_character(reader, closing)) {
+			return true;
+		}
+		do {
+			if (opening == '{') {
+				char key[MAX_FIELD_SIZE];
+				if (!read_scalar(reader, key) || !consume_character(reader, ':')) {
+					return false;
+				}
+			}
+			if (!skip_value(reader)) {
+				return false;
+			}
+		} while (consume_character(reader, ','));
+		return consume_character(reader, closing);
+	} else {
+		char value[MAX_FIELD_SIZE];
+		return read_scalar(reader, value);
+	}
+}
+
+struct perfmon_event {
+	char name[MAX_FIELD_SIZE];
+	char event_code[MAX_FIELD_SIZE];
+	char umask[MAX_FIELD_SIZE];
+	char cmask[MAX_FIELD_SIZE];
+	char inv[MAX_FIELD_SIZE];
+	char edge[MAX_FIELD_SIZE];
+	char counter[MAX_FIELD_SIZE];
+	char taken_alone[MAX_FIELD_SIZE];
+	char msr_index[MAX_FIELD_SIZE];
+	char deprecated[MAX_FIELD_SIZE];
+};
+
+static bool read_event_object(struct json_reader reader[restrict static 1], struct perfmon_event event[restrict static 1]) {
+	memset(event, 0, sizeof(struct perfmon_event));
+	if (!consume_character(reader, '{')) {
+		return false;
+	}
+	if (consume_character(reader, '}')) {
+		return true;
+	}
+	do {
+		char key[MAX_FIELD_SIZE];
+		if (!read_scalar(reader, key) || !consume_character(reader, ':')) {
+			return false;
+		}
+		char* field = NULL;
+		if (strcmp(key, "EventName") == 0) {
+			field = event->name;
+		} else if (strcmp(key, "EventCode") == 0) {
+			field = event->event_code;
+		} else if (strcmp(key, "UMask") == 0) {
+			field = event->umask;
+		} else if (strcmp(key, "CounterMask") == 0) {
+			field = event->cmask;
+		} else if (strcmp(key, "Invert") == 0) {
+			field = event->inv;
+		} else if (strcmp(key, "EdgeDetect") == 0) {
+			field = event->edge;
+		} else if (strcmp(key, "Counter") == 0) {
+			field = event->counter;
+		} else if (strcmp(key, "TakenAlone") == 0) {
+			field = event->taken_alone;
+		} else if (strcmp(key, "MSRIndex") == 0) {
+			field = event->msr_index;
+		} else if (strcmp(key, "Deprecated") == 0) {
+			field = event->deprecated;
+		}
+		if (field != NULL) {
+			if (!read_scalar(reader, field)) {
+				return false;
+			}
+		} else if (!skip_value(reader)) {
+			return false;
+		}
+	} while (consume_character(reader, ','));
+	return consume_character(reader, '}');
+}
+
+static bool parse_field(const char field[restrict static 1], uint32_t max_value, uint32_t value[restrict static 1]) {
+	if (*field == '\0') {
+		*value = 0;
+		return true;
+	}
+	char* field_end = NULL;
+	errno = 0;
+	const unsigned long parsed_value = strtoul(field, &field_end, 0);
+	if (errno != 0 || *field_end != '\0' || parsed_value > max_value) {
+		return false;
+	}
+	*value = (uint32_t) parsed_value;
+	return true;
+}
+
+/*
+ * @brief Parses the "Counter" field of an event into a mask of general-purpose counters.
+ * @details The field is a comma-separated list of counter numbers or ranges (e.g. "0,1,2,3" or "0-3"), or a name of
+ *          a fixed-function counter (e.g. "Fixed counter 1").
+ * @return true if the field describes general-purpose counters, false otherwise.
+ */
+static bool parse_counter_field(const char field[restrict static 1], uint8_t counters[restrict static 1]) {
+	*counters = 0;
+	const char* position = field;
+	while (*position != '\0') {
+		char* number_end = NULL;
+		const unsigned long first = strtoul(position, &number_end, 10);
+		if (number_end == position) {
+			return false;
+		}
+		unsigned long last = first;
+		if (*number_end == '-') {
+			position = number_end + 1;
+			last = strtoul(position, &number_end, 10);
+			if (number_end == position) {
+				return false;
+			}
+		}
+		for (unsigned long counter = first; counter <= last && counter < 8; counter++) {
+			*counters |= (uint8_t) (1u << counter);
+		}
+		position = number_end;
+		while (*position == ',' || *position == ' ') {
+			position++;
+		}
+	}
+	return true;
+}
+
+/*
+ * @brief Converts event description from a perfmon file into event specification.
+ * @return true if the event can be used with WebRunner, false if it must be skipped.
+ */
+static bool convert_event(const struct perfmon_event event[restrict static 1],
+	struct performance_counter_specification specification[restrict static 1])
+{
+	uint32_t event_code, umask, cmask, inv, edge, taken_alone, deprecated, msr_index;
+	if (event->name[0] == '\0' ||
+		!parse_field(event->event_code, 0xFFF, &event_code) ||
+		!parse_field(event->umask, UINT8_MAX, &umask) ||
+		!parse_field(event->cmask, UINT8_MAX, &cmask) ||
+		!parse_field(event->inv, 1, &inv) ||
+		!parse_field(event->edge, 1, &edge) ||
+		!parse_field(event->taken_alone, 1, &taken_alone) ||
+		!parse_field(event->deprecated, 1, &deprecated))
+	{
+		/* Events with several event codes (e.g. offcore response events) also end up here */
+		return false;
+	}
+	/* Events which need an auxiliary MSR (offcore response, load latency, etc) are not supported */
+	if (!parse_field(event->msr_index, UINT32_MAX, &msr_index) || msr_index != 0) {
+		return false;
+	}
+	if (deprecated != 0) {
+		return false;
+	}
+	/* Events on fixed-function counters are covered by the generic events */
+	uint8_t counters = 0;
+	if (!parse_counter_field(event->counter, &counters)) {
+		return false;
+	}
+	*specification = (struct performance_counter_specification) {
+		.name = strdup(event->name),
+		.event = (uint16_t) event_code,
+		.umask = (uint8_t) umask,
+		.inv = (uint8_t) inv,
+		.cmask = (uint8_t) cmask,
+		.edge = (uint8_t) edge,
+		.counters = counters,
+		.exclusive = taken_alone != 0,
+	};
+	return true;
+}
+
+static char* read_file(const char* path, size_t size[restrict static 1]) {
+	FILE* file = fopen(path, "rb");
+	if (file == NULL) {
+		log_error("failed to open %s: %s\n", path, strerror(errno));
+		return NULL;
+	}
+	char* content = NULL;
+	size_t content_size = 0, capacity = 0;
+	for (;;) {
+		if (content_size == capacity) {
+			capacity = capacity == 0 ? 65536 : capacity * 2;
+			char* new_content = realloc(content, capacity);
+			if (new_content == NULL) {
+				log_error("failed to allocate memory for %s\n", path);
+				free(content);
+				fclose(file);
+				return NULL;
+			}
+			content = new_content;
+		}
+		const size_t bytes_read = fread(&content[content_size], 1, capacity - content_size, file);
+		if (bytes_read == 0) {
+			break;
+		}
+		content_size += bytes_read;
+	}
+	fclose(file);
+	*size = content_size;
+	return content;
+}
+
+static bool parse_event_file(const char* path, struct performance_event_table event_table[restrict static 1]) {
+	size_t content_size = 0;
+	char* content = read_file(path, &content_size);
+	if (content == NULL) {
+		return false;
+	}
+
+	struct json_reader reader = {
+		.position = content,
+		.end = content + content_size,
+	};
+	/* Newer perfmon releases wrap the array of events into an object with Header and Events members */
+	if (consume_character(&reader, '{')) {
+		bool found_events = false;
+		do {
+			char key[MAX_FIELD_SIZE];
+			if (!read_scalar(&reader, key) || !consume_character(&reader, ':')) {
+				break;
+			}
+			if (strcmp(key, "Events") == 0) {
+				found_events = true;
+				break;
+			}
+			if (!skip_value(&reader)) {
+				break;
+			}
+		} while (consume_character(&reader, ','));
+		if (!found_events) {
+			log_error("failed to parse %s: no Events member\n", path);
+			free(content);
+			return false;
+		}
+	}
+
+	if (!consume_character(&reader, '[')) {
+		log_error("failed to parse %s: expected an array of events\n", path);
+		free(content);
+		return false;
+	}
+	size_t capacity = 0;
+	struct performance_counter_specification* events = NULL;
+	size_t count = 0;
+	if (!consume_character(&reader, ']')) {
+		do {
+			struct perfmon_event event;
+			if (!read_event_object(&reader, &event)) {
+				log_error("failed to parse %s: invalid event object at offset %zu\n",
+					path, (size_t) (reader.position - content));
+				free(events);
+				free(content);
+				return false;
+			}
+			if (count == capacity) {
+				capacity = capacity == 0 ? 256 : capacity * 2;
+				events = realloc(events, capacity * sizeof(struct performance_counter_specification));
+				if (events == NULL) {
+					log_fatal("failed to allocate memory for event table\n");
+				}
+			}
+			if (convert_event(&event, &events[count])) {
+				count++;
+			}
+		} while (consume_character(&reader, ','));
+	}
+	free(content);
+
+	event_table->events = events;
+	event_table->count = count;
+	return true;
+}
+
+bool load_perfmon_event_table(const char* events_directory, const struct x86_cpu_info cpu_info[restrict static 1],
+	struct performance_event_table event_table[restrict static 1])
+{
+	/* perfmon identifies processors as Vendor-Family-Model[-Stepping] with decimal family and hexadecimal model */
+	char cpu_id[64], cpu_id_with_stepping[64];
+	snprintf(cpu_id, sizeof(cpu_id), "%s-%"PRIu32"-%02"PRIX32,
+		cpu_info->vendor, cpu_info->display_family, cpu_info->display_model);
+	snprintf(cpu_id_with_stepping, sizeof(cpu_id_with_stepping), "%s-%"PRIu32"-%02"PRIX32"-%"PRIX32,
+		cpu_info->vendor, cpu_info->display_family, cpu_info->display_model, cpu_info->stepping);
+
+	char mapfile_path[PATH_MAX];
+	snprintf(mapfile_path, sizeof(mapfile_path), "%s/mapfile.csv", events_directory);
+	FILE* mapfile = fopen(mapfile_path, "r");
+	if (mapfile == NULL) {
+		log_error("failed to open %s: %s\n", mapfile_path, strerror(errno));
+		return false;
+	}
+
+	bool loaded = false;
+	char line[1024];
+	while (!loaded && fgets(line, sizeof(line), mapfile) != NULL) {
+		/* Columns: Family-model,Version,Filename,EventType[,...] */
+		char* columns[4] = { NULL };
+		char* saveptr = NULL;
+		char* column = strtok_r(line, ",\r\n", &saveptr);
+		size_t column_count = 0;
+		for (; column != NULL && column_count < 4; column = strtok_r(NULL, ",\r\n", &saveptr)) {
+			columns[column_count++] = column;
+		}
+		if (column_count < 4 || strcmp(columns[3], "core") != 0) {
+			continue;
+		}
+
+		char pattern[512];
+		snprintf(pattern, sizeof(pattern), "^(%s)$", columns[0]);
+		regex_t regex;
+		if (regcomp(&regex, pattern, REG_EXTENDED | REG_NOSUB) != 0) {
+			continue;
+		}
+		const bool matches = regexec(&regex, cpu_id_with_stepping, 0, NULL, 0) == 0 ||
+			regexec(&regex, cpu_id, 0, NULL, 0) == 0;
+		regfree(&regex);
+		if (!matches) {
+			continue;
+		}
+
+		char event_file_path[PATH_MAX];
+		snprintf(event_file_path, sizeof(event_file_path), "%s/%s", events_directory,
+			columns[2][0] == '/' ? &columns[2][1] : columns[2]);
+		if (parse_event_file(event_file_path, event_table)) {
+			event_table->name = strdup(event_file_path);
+			loaded = true;
+		}
+	}
+	fclose(mapfile);
+	return loaded;
+}
@@ -0,0 +1,117 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <runner/perfctr.h>
+
+#define NO_COUNTER SIZE_MAX
+
+/*
+ * @brief Tries to find an augmenting path for a group member in the bipartite graph of members and hardware counters.
+ * @param[in]      counter_masks Masks of hardware counters allowed for each group member.
+ * @param[in]      member        Index of the group member to place.
+ * @param[in, out] visited       Mask of hardware counters visited during the search.
+ * @param[in, out] assignment    Group member currently placed on each hardware counter, or NO_COUNTER.
+ * @return true if the member was placed, possibly after moving other members to different hardware counters.
+ */
+static bool place_member(const uint64_t counter_masks[restrict static 1], size_t member,
+	uint64_t visited[restrict static 1], size_t assignment[restrict static 64])
+{
+	uint64_t candidates = counter_masks[member] & ~*visited;
+	while (candidates != 0) {
+		const unsigned int hardware_counter = __builtin_ctzll(candidates);
+		candidates &= candidates - 1;
+		*visited |= UINT64_C(1) << hardware_counter;
+		if (assignment[hardware_counter] == NO_COUNTER ||
+			place_member(counter_masks, assignment[hardware_counter], visited, assignment))
+		{
+			assignment[hardware_counter] = member;
+			return true;
+		}
+	}
+	return false;
+}
+
+struct group_plan {
+	uint64_t counter_masks[MAX_GROUP_COUNTERS];
+	size_t assignment[64];
+	bool exclusive;
+};
+
+size_t plan_performance_counter_groups(size_t counter_count,
+	const struct performance_counter counters[restrict static counter_count],
+	struct performance_counter_group groups[restrict static counter_count])
+{
+	/* Order counters from the most to the least constrained (stable w.r.t. the original order) */
+	size_t order[counter_count];
+	for (size_t i = 0; i < counter_count; i++) {
+		order[i] = i;
+	}
+	for (size_t i = 1; i < counter_count; i++) {
+		const size_t counter = order[i];
+		const int popcount = __builtin_popcountll(counters[counter].counter_mask);
+		size_t j = i;
+		for (; j != 0 && __builtin_popcountll(counters[order[j - 1]].counter_mask) > popcount; j--) {
+			order[j] = order[j - 1];
+		}
+		order[j] = counter;
+	}
+
+	struct group_plan plans[counter_count];
+	size_t group_count = 0;
+	for (size_t i = 0; i < counter_count; i++) {
+		const size_t counter = order[i];
+		const uint64_t counter_mask = counters[counter].counter_mask;
+		const bool exclusive = counters[counter].exclusive;
+		size_t group = 0;
+		for (; group < group_count; group++) {
+			const size_t member = groups[group].count;
+			if (member == MAX_GROUP_COUNTERS) {
+				continue;
+			}
+			/* Events which do not need a hardware counter (e.g. software events) fit into any group */
+			if (counter_mask == 0) {
+				break;
+			}
+			if (exclusive || plans[group].exclusive) {
+				continue;
+			}
+			plans[group].counter_masks[member] = counter_mask;
+			uint64_t visited = 0;
+			if (place_member(plans[group].counter_masks, member, &visited, plans[group].assignment)) {
+				break;
+			}
+		}
+		if (group == group_count) {
+			/* No existing group can host the counter: start a new group */
+			groups[group].file_descriptor = -1;
+			groups[group].count = 0;
+			for (size_t hardware_counter = 0; hardware_counter < 64; hardware_counter++) {
+				plans[group].assignment[hardware_counter] = NO_COUNTER;
+			}
+			plans[group].counter_masks[0] = counter_mask;
+			plans[group].exclusive = exclusive;
+			if (counter_mask != 0) {
+				uint64_t visited = 0;
+				place_member(plans[group].counter_masks, 0, &visited, plans[group].assignment);
+			}
+			group_count++;
+		}
+		plans[group].counter_masks[groups[group].count] = counter_mask;
+		groups[group].counter_index[groups[group].count++] = counter;
+	}
+
+	/* Restore the original order within each group so that reports follow the order of the event table */
+	for (size_t group = 0; group < group_count; group++) {
+		for (size_t i = 1; i < groups[group].count; i++) {
+			const size_t counter = groups[group].counter_index[i];
+			size_t j = i;
+			for (; j != 0 && groups[group].counter_index[j - 1] > counter; j--) {
+				groups[group].counter_index[j] = groups[group].counter_index[j - 1];
+			}
+			groups[group].counter_index[j] = counter;
+		}
+	}
+	return group_count;
+}
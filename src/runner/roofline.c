@@ -0,0 +1,324 @@
+#include <stdio.h>
+#include <limits.h>
+#include <inttypes.h>
+#include <string.h>
+#include <immintrin.h>
+
+#include <sys/mman.h>
+
+#include <webserver/logs.h>
+#include <runner/roofline.h>
+#include <runner/timing.h>
+#include <runner/cache.h>
+
+/* Number of iterations of the floating-point peak loop */
+#define FLOPS_ITERATIONS 1000000
+
+/* Size of the buffer for the memory bandwidth measurement, which must exceed the last-level cache */
+#define MIN_BANDWIDTH_BUFFER_SIZE (64 * 1024 * 1024)
+#define MAX_BANDWIDTH_BUFFER_SIZE (512 * 1024 * 1024)
+
+/* Bytes read in each repetition of a cache bandwidth measurement */
+#define CACHE_BANDWIDTH_BYTES (16 * 1024 * 1024)
+
+/* Number of repetitions of each measurement; the fastest one counts */
+#define PEAK_REPETITIONS 3
+
+static struct machine_peaks machine_peaks;
+
+/* Ten independent FMA chains hide the FMA latency on all x86 cores with two FMA units */
+__attribute__((target("avx2,fma")))
+static float measure_fma_peak(uint64_t ticks[restrict static 1]) {
+	__m256 acc0 = _mm256_set1_ps(0.0f), acc1 = acc0, acc2 = acc0, acc3 = acc0, acc4 = acc0;
+	__m256 acc5 = acc0, acc6 = acc0, acc7 = acc0, acc8 = acc0, acc9 = acc0;
+	const __m256 a = _mm256_set1_ps(0.999999f), b = _mm256_set1_ps(1.0e-7f);
+	const uint64_t start_tsc = read_tsc_start();
+	for (size_t iteration = 0; iteration < FLOPS_ITERATIONS; iteration++) {
+		acc0 = _mm256_fmadd_ps(acc0, a, b);
+		acc1 = _mm256_fmadd_ps(acc1, a, b);
+		acc2 = _mm256_fmadd_ps(acc2, a, b);
+		acc3 = _mm256_fmadd_ps(acc3, a, b);
+		acc4 = _mm256_fmadd_ps(acc4, a, b);
+		acc5 = _mm256_fmadd_ps(acc5, a, b);
+		acc6 = _mm256_fmadd_ps(acc6, a, b);
+		acc7 = _mm256_fmadd_ps(acc7, a, b);
+		acc8 = _mm256_fmadd_ps(acc8, a, b);
+		acc9 = _mm256_fmadd_ps(acc9, a, b);
+	}
+	*ticks = __rdtsc() - start_tsc;
+	const __m256 sum = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(acc0, acc1), _mm256_add_ps(acc2, acc3)),
+		_mm256_add_ps(_mm256_add_ps(_mm256_add_ps(acc4, acc5), _mm256_add_ps(acc6, acc7)), _mm256_add_ps(acc8, acc9)));
+	return _mm256_cvtss_f32(sum);
+}
+
+__attribute__((target("avx2,fma")))
+static double measure_double_fma_peak(uint64_t ticks[restrict static 1]) {
+	__m256d acc0 = _mm256_set1_pd(0.0), acc1 = acc0, acc2 = acc0, acc3 = acc0, acc4 = acc0;
+	__m256d acc5 = acc0, acc6 = acc0, acc7 = acc0, acc8 = acc0, acc9 = acc0;
+	const __m256d a = _mm256_set1_pd(0.999999), b = _mm256_set1_pd(1.0e-7);
+	const uint64_t start_tsc = read_tsc_start();
+	for (size_t iteration = 0; iteration < FLOPS_ITERATIONS; iteration++) {
+		acc0 = _mm256_fmadd_pd(acc0, a, b);
+		acc1 = _mm256_fmadd_pd(acc1, a, b);
+		acc2 = _mm256_fmadd_pd(acc2, a, b);
+		acc3 = _mm256_fmadd_pd(acc3, a, b);
+		acc4 = _mm256_fmadd_pd(acc4, a, b);
+		acc5 = _mm256_fmadd_pd(acc5, a, b);
+		acc6 = _mm256_fmadd_pd(acc6, a, b);
+		acc7 = _mm256_fmadd_pd(acc7, a, b);
+		acc8 = _mm256_fmadd_pd(acc8, a, b);
+		acc9 = _mm256_fmadd_pd(acc9, a, b);
+	}
+	*ticks = __rdtsc() - start_tsc;
+	const __m256d sum = _mm256_add_pd(_mm256_add_pd(_mm256_add_pd(acc0, acc1), _mm256_add_pd(acc2, acc3)),
+		_mm256_add_pd(_mm256_add_pd(_mm256_add_pd(acc4, acc5), _mm256_add_pd(acc6, acc7)), _mm256_add_pd(acc8, acc9)));
+	return _mm256_cvtsd_f64(sum);
+}
+
+/* Separate multiply and add chains for processors without FMA */
+static float measure_sse_peak(uint64_t ticks[restrict static 1]) {
+	__m128 mul0 = _mm_set1_ps(1.0f), mul1 = mul0, mul2 = mul0, mul3 = mul0, mul4 = mul0;
+	__m128 add0 = _mm_set1_ps(0.0f), add1 = add0, add2 = add0, add3 = add0, add4 = add0;
+	const __m128 a = _mm_set1_ps(0.999999f), b = _mm_set1_ps(1.0e-7f);
+	const uint64_t start_tsc = read_tsc_start();
+	for (size_t iteration = 0; iteration < FLOPS_ITERATIONS; iteration++) {
+		mul0 = _mm_mul_ps(mul0, a);
+		add0 = _mm_add_ps(add0, b);
+		mul1 = _mm_mul_ps(mul1, a);
+		add1 = _mm_add_ps(add1, b);
+		mul2 = _mm_mul_ps(mul2, a);
+		add2 = _mm_add_ps(add2, b);
+		mul3 = _mm_mul_ps(mul3, a);
+		add3 = _mm_add_ps(add3, b);
+		mul4 = _mm_mul_ps(mul4, a);
+		add4 = _mm_add_ps(add4, b);
+	}
+	*ticks = __rdtsc() - start_tsc;
+	const __m128 sum = _mm_add_ps(_mm_add_ps(_mm_add_ps(mul0, mul1), _mm_add_ps(mul2, mul3)),
+		_mm_add_ps(_mm_add_ps(_mm_add_ps(add0, add1), _mm_add_ps(add2, add3)), _mm_add_ps(mul4, add4)));
+	return _mm_cvtss_f32(sum);
+}
+
+static double measure_double_sse_peak(uint64_t ticks[restrict static 1]) {
+	__m128d mul0 = _mm_set1_pd(1.0), mul1 = mul0, mul2 = mul0, mul3 = mul0, mul4 = mul0;
+	__m128d add0 = _mm_set1_pd(0.0), add1 = add0, add2 = add0, add3 = add0, add4 = add0;
+	const __m128d a = _mm_set1_pd(0.999999), b = _mm_set1_pd(1.0e-7);
+	const uint64_t start_tsc = read_tsc_start();
+	for (size_t iteration = 0; iteration < FLOPS_ITERATIONS; iteration++) {
+		mul0 = _mm_mul_pd(mul0, a);
+		add0 = _mm_add_pd(add0, b);
+		mul1 = _mm_mul_pd(mul1, a);
+		add1 = _mm_add_pd(add1, b);
+		mul2 = _mm_mul_pd(mul2, a);
+		add2 = _mm_add_pd(add2, b);
+		mul3 = _mm_mul_pd(mul3, a);
+		add3 = _mm_add_pd(add3, b);
+		mul4 = _mm_mul_pd(mul4, a);
+		add4 = _mm_add_pd(add4, b);
+	}
+	*ticks = __rdtsc() - start_tsc;
+	const __m128d sum = _mm_add_pd(_mm_add_pd(_mm_add_pd(mul0, mul1), _mm_add_pd(mul2, mul3)),
+		_mm_add_pd(_mm_add_pd(_mm_add_pd(add0, add1), _mm_add_pd(add2, add3)), _mm_add_pd(mul4, add4)));
+	return _mm_cvtsd_f64(sum);
+}
+
+static uint64_t measure_read_bandwidth(const __m128i* buffer, size_t size, size_t passes, __m128i sum[restrict static 1]) {
+	__m128i sum0 = _mm_setzero_si128(), sum1 = sum0, sum2 = sum0, sum3 = sum0;
+	const uint64_t start_tsc = read_tsc_start();
+	for (size_t pass = 0; pass < passes; pass++) {
+		for (size_t i = 0; i < size / sizeof(__m128i); i += 4) {
+			sum0 = _mm_add_epi64(sum0, _mm_load_si128(&buffer[i]));
+			sum1 = _mm_add_epi64(sum1, _mm_load_si128(&buffer[i + 1]));
+			sum2 = _mm_add_epi64(sum2, _mm_load_si128(&buffer[i + 2]));
+			sum3 = _mm_add_epi64(sum3, _mm_load_si128(&buffer[i + 3]));
+		}
+	}
+	const uint64_t ticks = __rdtsc() - start_tsc;
+	*sum = _mm_add_epi64(_mm_add_epi64(sum0, sum1), _mm_add_epi64(sum2, sum3));
+	return ticks;
+}
+
+/* Cache bandwidth depends on the load width, so read with the widest loads which kernels use */
+__attribute__((target("avx2")))
+static uint64_t measure_avx2_read_bandwidth(const __m256i* buffer, size_t size, size_t passes, __m128i sum[restrict static 1]) {
+	__m256i sum0 = _mm256_setzero_si256(), sum1 = sum0, sum2 = sum0, sum3 = sum0;
+	const uint64_t start_tsc = read_tsc_start();
+	for (size_t pass = 0; pass < passes; pass++) {
+		for (size_t i = 0; i < size / sizeof(__m256i); i += 4) {
+			sum0 = _mm256_add_epi64(sum0, _mm256_load_si256(&buffer[i]));
+			sum1 = _mm256_add_epi64(sum1, _mm256_load_si256(&buffer[i + 1]));
+			sum2 = _mm256_add_epi64(sum2, _mm256_load_si256(&buffer[i + 2]));
+			sum3 = _mm256_add_epi64(sum3, _mm256_load_si256(&buffer[i + 3]));
+		}
+	}
+	const uint64_t ticks = __rdtsc() - start_tsc;
+	const __m256i total = _mm256_add_epi64(_mm256_add_epi64(sum0, sum1), _mm256_add_epi64(sum2, sum3));
+	*sum = _mm_add_epi64(_mm256_castsi256_si128(total), _mm256_extracti128_si256(total, 1));
+	return ticks;
+}
+
+/*
+ * Measures the read bandwidth of a cache level with a buffer of half its size, which stays in the level
+ * even if the level is shared with instructions or other data. Returns bytes per TSC tick.
+ */
+static double measure_cache_bandwidth(const void* buffer, size_t cache_size, bool avx2, __m128i sum[restrict static 1]) {
+	/* Four loads of up to 32 bytes per iteration */
+	const size_t size = (cache_size / 2) & -(size_t) 128;
+	if (size == 0) {
+		return 0.0;
+	}
+	const size_t passes = CACHE_BANDWIDTH_BYTES / size + 1;
+	uint64_t best_ticks = UINT64_MAX;
+	/* The first repetition also brings the buffer into the cache */
+	for (size_t repetition = 0; repetition <= PEAK_REPETITIONS; repetition++) {
+		__m128i repetition_sum;
+		const uint64_t ticks = avx2 ?
+			measure_avx2_read_bandwidth(buffer, size, passes, &repetition_sum) :
+			measure_read_bandwidth(buffer, size, passes, &repetition_sum);
+		*sum = _mm_add_epi64(*sum, repetition_sum);
+		if (repetition != 0) {
+			best_ticks = ticks < best_ticks ? ticks : best_ticks;
+		}
+	}
+	return (double) (size * passes) / (double) best_ticks;
+}
+
+const struct machine_peaks* init_machine_peaks(void) {
+	__builtin_cpu_init();
+	const bool fma = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+	uint64_t best_ticks = UINT64_MAX;
+	volatile float flops_sink = 0.0f;
+	for (size_t repetition = 0; repetition < PEAK_REPETITIONS; repetition++) {
+		uint64_t ticks;
+		flops_sink += fma ? measure_fma_peak(&ticks) : measure_sse_peak(&ticks);
+		best_ticks = ticks < best_ticks ? ticks : best_ticks;
+	}
+	/* FMA loop: 10 FMAs x 8 lanes x 2 operations; SSE loop: 10 operations x 4 lanes */
+	const double flops_per_iteration = fma ? 160.0 : 40.0;
+	machine_peaks.flops_per_tick = flops_per_iteration * FLOPS_ITERATIONS / (double) best_ticks;
+	/* Double-precision vectors hold half as many lanes */
+	best_ticks = UINT64_MAX;
+	volatile double double_flops_sink = 0.0;
+	for (size_t repetition = 0; repetition < PEAK_REPETITIONS; repetition++) {
+		uint64_t ticks;
+		double_flops_sink += fma ? measure_double_fma_peak(&ticks) : measure_double_sse_peak(&ticks);
+		best_ticks = ticks < best_ticks ? ticks : best_ticks;
+	}
+	machine_peaks.double_flops_per_tick = flops_per_iteration / 2.0 * FLOPS_ITERATIONS / (double) best_ticks;
+	machine_peaks.isa = fma ? "AVX2 FMA" : "SSE";
+
+	size_t buffer_size = 4 * get_last_level_cache_size();
+	buffer_size = buffer_size < MIN_BANDWIDTH_BUFFER_SIZE ? MIN_BANDWIDTH_BUFFER_SIZE : buffer_size;
+	buffer_size = buffer_size > MAX_BANDWIDTH_BUFFER_SIZE ? MAX_BANDWIDTH_BUFFER_SIZE : buffer_size;
+	void* buffer = mmap(NULL, buffer_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+	if (buffer == MAP_FAILED) {
+		log_error("failed to allocate memory for bandwidth measurement\n");
+		return &machine_peaks;
+	}
+	/* Write the buffer so that pages are not backed by the shared zero page */
+	memset(buffer, 1, buffer_size);
+	best_ticks = UINT64_MAX;
+	__m128i sum = _mm_setzero_si128();
+	for (size_t repetition = 0; repetition < PEAK_REPETITIONS; repetition++) {
+		__m128i repetition_sum;
+		const uint64_t ticks = measure_read_bandwidth(buffer, buffer_size, 1, &repetition_sum);
+		sum = _mm_add_epi64(sum, repetition_sum);
+		best_ticks = ticks < best_ticks ? ticks : best_ticks;
+	}
+	const struct x86_cache_info* cache_info = get_cache_info();
+	const bool avx2 = __builtin_cpu_supports("avx2");
+	for (size_t i = 0; i < cache_info->count; i++) {
+		if (cache_info->levels[i].size < buffer_size) {
+			machine_peaks.cache_bytes_per_tick[i] = measure_cache_bandwidth(buffer, cache_info->levels[i].size, avx2, &sum);
+		}
+	}
+	volatile int64_t bandwidth_sink = _mm_cvtsi128_si64(sum);
+	(void) bandwidth_sink;
+	munmap(buffer, buffer_size);
+	machine_peaks.bytes_per_tick = (double) buffer_size / (double) best_ticks;
+	return &machine_peaks;
+}
+
+void report_roofline(int connection_socket, const struct kernel_work work[restrict static 1],
+	unsigned long long cycles, const char* cycles_name, unsigned long long tsc_ticks, uint64_t tsc_frequency,
+	uint64_t working_set, enum cache_mode cache_mode)
+{
+	if (cycles == 0) {
+		return;
+	}
+	if (work->elements != 0) {
+		dprintf(connection_socket, "%s per element: %.3lf\n", cycles_name, (double) cycles / (double) work->elements);
+	}
+	if (work->flops != 0) {
+		dprintf(connection_socket, "FLOPs per cycle: %.3lf\n", (double) work->flops / (double) cycles);
+	}
+	if (work->bytes != 0) {
+		dprintf(connection_socket, "Bytes per cycle: %.3lf\n", (double) work->bytes / (double) cycles);
+	}
+	if (tsc_ticks == ULLONG_MAX || tsc_ticks == 0) {
+		return;
+	}
+	if (tsc_frequency != 0) {
+		const double seconds = (double) tsc_ticks / (double) tsc_frequency;
+		if (work->flops != 0) {
+			dprintf(connection_socket, "GFLOP/s: %.3lf\n", (double) work->flops / seconds * 1.0e-9);
+		}
+		if (work->bytes != 0) {
+			dprintf(connection_socket, "GB/s: %.3lf\n", (double) work->bytes / seconds * 1.0e-9);
+		}
+	}
+	/* Warm arguments stream from the closest cache level which holds them, others from memory */
+	double bytes_per_tick = machine_peaks.bytes_per_tick;
+	char bandwidth_source[sizeof("memory read")] = "memory read";
+	if (cache_mode == cache_mode_warm && working_set != 0) {
+		const struct x86_cache_info* cache_info = get_cache_info();
+		for (size_t i = 0; i < cache_info->count; i++) {
+			if (working_set <= cache_info->levels[i].size) {
+				if (machine_peaks.cache_bytes_per_tick[i] != 0.0) {
+					bytes_per_tick = machine_peaks.cache_bytes_per_tick[i];
+					snprintf(bandwidth_source, sizeof(bandwidth_source), "L%"PRIu32" read", cache_info->levels[i].level);
+				}
+				break;
+			}
+		}
+	}
+	const double flops_per_tick = work->double_precision ? machine_peaks.double_flops_per_tick : machine_peaks.flops_per_tick;
+	if (work->flops != 0 && work->bytes != 0 && flops_per_tick != 0.0 && bytes_per_tick != 0.0) {
+		/* Attainable performance is bounded by the compute peak and by bandwidth times arithmetic intensity */
+		const double intensity = (double) work->flops / (double) work->bytes;
+		const double memory_bound = intensity * bytes_per_tick;
+		const bool compute_bound = flops_per_tick <= memory_bound;
+		const double attainable = compute_bound ? flops_per_tick : memory_bound;
+		const double achieved = (double) work->flops / (double) tsc_ticks;
+		dprintf(connection_socket, "Roofline: %.3lf FLOP/byte, %s-bound, %.3lf of %.3lf attainable FLOPs per TSC tick (%.1lf%%)\n",
+			intensity, compute_bound ? "compute" : "memory", achieved, attainable, 100.0 * achieved / attainable);
+		dprintf(connection_socket, "Machine peaks: %.2lf %s FLOPs per TSC tick (%s), %.2lf bytes per TSC tick (%s)\n",
+			flops_per_tick, work->double_precision ? "double-precision" : "single-precision", machine_peaks.isa,
+			bytes_per_tick, bandwidth_source);
+	}
+}
+
+void report_parallel_throughput(int connection_socket, const struct kernel_work work[restrict static 1],
+	size_t thread_count, const unsigned long long tsc_ticks[restrict static thread_count], uint64_t tsc_frequency)
+{
+	if (tsc_frequency == 0) {
+		return;
+	}
+	/* Threads run concurrently, so their call rates add up */
+	double calls_per_second = 0.0;
+	for (size_t i = 0; i < thread_count; i++) {
+		if (tsc_ticks[i] != ULLONG_MAX && tsc_ticks[i] != 0) {
+			calls_per_second += (double) tsc_frequency / (double) tsc_ticks[i];
+		}
+	}
+	if (calls_per_second == 0.0) {
+		return;
+	}
+	dprintf(connection_socket, "Aggregate calls per second: %.0lf\n", calls_per_second);
+	if (work->flops != 0) {
+		dprintf(connection_socket, "Aggregate GFLOP/s: %.3lf\n", (double) work->flops * calls_per_second * 1.0e-9);
+	}
+	if (work->bytes != 0) {
+		dprintf(connection_socket, "Aggregate GB/s: %.3lf\n", (double) work->bytes * calls_per_second * 1.0e-9);
+	}
+}
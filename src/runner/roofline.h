@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <runner/cache.h>
+
+/* Work and memory traffic of one kernel call, as declared in the kernel specification */
+struct kernel_work {
+	/* Floating-point operations, or 0 if not declared */
+	uint64_t flops;
+	/* Bytes read or written in memory, or 0 if not declared */
+	uint64_t bytes;
+	/* Elements processed, or 0 if not declared */
+	uint64_t elements;
+	/* The floating-point operations are double-precision */
+	bool double_precision;
+};
+
+struct machine_peaks {
+	/* Single-precision floating-point operations per TSC tick on one core */
+	double flops_per_tick;
+	/* Double-precision floating-point operations per TSC tick on one core */
+	double double_flops_per_tick;
+	/* Bytes streamed from memory per TSC tick on one core */
+	double bytes_per_tick;
+	/* Bytes read per TSC tick on one core from each data cache level reported by get_cache_info, or 0 if not measured */
+	double cache_bytes_per_tick[MAX_CACHE_LEVELS];
+	/* Instruction set of the floating-point peak measurement */
+	const char* isa;
+};
+
+/**
+ * @brief Measures the floating-point throughput and the cache and memory read bandwidth of one core.
+ * @details Takes a fraction of a second, so the function should be called once at server startup, after init_cache_info.
+ *          The result is cached and inherited by the request processes.
+ */
+const struct machine_peaks* init_machine_peaks(void);
+
+/**
+ * @brief Writes work-normalized metrics and the roofline position of the kernel to the connection socket.
+ * @details Per-cycle metrics use @a cycles. Time-based metrics and the roofline use @a tsc_ticks, because the machine
+ *          peaks are measured per TSC tick. In the warm cache mode the bandwidth roof is the read bandwidth of the closest
+ *          cache level which holds the working set; otherwise it is the memory bandwidth.
+ * @param[in] work           Work and memory traffic of a kernel call.
+ * @param[in] cycles         Cycles per kernel call.
+ * @param[in] cycles_name    Name of the cycle measurement, e.g. core cycles or TSC ticks.
+ * @param[in] tsc_ticks      TSC ticks per kernel call, or ULLONG_MAX if unknown.
+ * @param[in] tsc_frequency  TSC frequency in Hz to convert TSC ticks to time, or 0 if unknown.
+ * @param[in] working_set    Total size of the argument buffers of a kernel call in bytes, or 0 if unknown.
+ * @param[in] cache_mode     Cache state of the arguments during the measurement.
+ */
+void report_roofline(int connection_socket, const struct kernel_work work[restrict static 1],
+	unsigned long long cycles, const char* cycles_name, unsigned long long tsc_ticks, uint64_t tsc_frequency,
+	uint64_t working_set, enum cache_mode cache_mode);
+
+/**
+ * @brief Writes the combined throughput of threads which called the kernel in parallel to the connection socket.
+ * @param[in] work          Work and memory traffic of a kernel call.
+ * @param[in] thread_count  Number of threads.
+ * @param[in] tsc_ticks     TSC ticks per kernel call on each thread, or ULLONG_MAX if the thread was not measured.
+ * @param[in] tsc_frequency TSC frequency in Hz to convert ticks to time, or 0 if unknown.
+ */
+void report_parallel_throughput(int connection_socket, const struct kernel_work work[restrict static 1],
+	size_t thread_count, const unsigned long long tsc_ticks[restrict static thread_count], uint64_t tsc_frequency);
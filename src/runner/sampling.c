@@ -0,0 +1,231 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include <webserver/logs.h>
+#include <runner/perfctr.h>
+#include <runner/sampling.h>
+
+/* Number of data pages in the ring buffer of a sampling counter (must be a power of 2) */
+#define SAMPLING_BUFFER_PAGES 64
+
+/* Maximum number of hot offsets to report */
+#define MAX_HOTSPOTS 16
+
+/* Number of code bytes to include before the first and after the last hot offset */
+#define HOT_REGION_MARGIN 16
+
+/* Maximum number of code bytes to report */
+#define MAX_HOT_REGION_SIZE 512
+
+static int perf_event_open(struct perf_event_attr *hw_event, pid_t pid, int cpu, int group_fd, unsigned long flags) {
+	return syscall(__NR_perf_event_open, hw_event, pid, cpu, group_fd, flags);
+}
+
+static int open_sampling_counter(uint32_t type, uint64_t config, uint64_t period) {
+	struct perf_event_attr perf_event_attr;
+	memset(&perf_event_attr, 0, sizeof(perf_event_attr));
+	perf_event_attr.type = type;
+	perf_event_attr.size = sizeof(perf_event_attr);
+	perf_event_attr.config = config;
+	perf_event_attr.sample_period = period;
+	perf_event_attr.sample_type = PERF_SAMPLE_IP;
+	perf_event_attr.disabled = 1;
+	perf_event_attr.exclude_kernel = 1;
+	perf_event_attr.exclude_hv = 1;
+	/* Prefer precise (PEBS/IBS) samples to reduce skid, but fall back to imprecise samples if not supported */
+	for (int precise_ip = 2; precise_ip >= 0; precise_ip--) {
+		perf_event_attr.precise_ip = precise_ip;
+		const int file_descriptor = perf_event_open(&perf_event_attr, 0, -1, -1, 0);
+		if (file_descriptor != -1) {
+			return file_descriptor;
+		}
+	}
+	return -1;
+}
+
+struct sampling_counters init_sampling_counters(size_t events_size, const char* events, uint64_t period) {
+	if (events == NULL) {
+		events = "Cycles";
+		events_size = strlen(events);
+	}
+	size_t count = 0;
+	struct performance_counter* performance_counters = create_performance_counters(events_size, events, &count);
+
+	const size_t page_size = (size_t) sysconf(_SC_PAGESIZE);
+	struct sampling_counter* sampling_counters = (struct sampling_counter*) malloc(count * sizeof(struct sampling_counter));
+	size_t sampling_count = 0;
+	for (size_t i = 0; i < count; i++) {
+		const int file_descriptor = open_sampling_counter(performance_counters[i].type, performance_counters[i].config, period);
+		if (file_descriptor == -1) {
+			continue;
+		}
+
+		const size_t mapping_size = (1 + SAMPLING_BUFFER_PAGES) * page_size;
+		void* mapping = mmap(NULL, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, file_descriptor, 0);
+		if (mapping == MAP_FAILED) {
+			log_error("failed to map ring buffer for %s: %s\n", performance_counters[i].name, strerror(errno));
+			close(file_descriptor);
+			continue;
+		}
+
+		sampling_counters[sampling_count++] = (struct sampling_counter) {
+			.name = performance_counters[i].name,
+			.file_descriptor = file_descriptor,
+			.metadata = (struct perf_event_mmap_page*) mapping,
+			.data = (const uint8_t*) mapping + page_size,
+			.data_size = SAMPLING_BUFFER_PAGES * page_size,
+		};
+	}
+	free(performance_counters);
+
+	return (struct sampling_counters) {
+		.counters = sampling_counters,
+		.count = sampling_count,
+	};
+}
+
+struct sample_histogram init_sample_histogram(const void* code, size_t code_size) {
+	uint32_t* counts = (uint32_t*) calloc(code_size, sizeof(uint32_t));
+	if (counts == NULL) {
+		log_fatal("failed to allocate sample histogram\n");
+	}
+	return (struct sample_histogram) {
+		.counts = counts,
+		.code = (const uint8_t*) code,
+		.code_size = code_size,
+	};
+}
+
+void drain_sampling_counter(const struct sampling_counter counter[restrict static 1],
+	struct sample_histogram histogram[restrict static 1])
+{
+	volatile struct perf_event_mmap_page* metadata = counter->metadata;
+	const uint64_t head = metadata->data_head;
+	/* Make sure that records are read only after data_head (see perf_event_open man page) */
+	__sync_synchronize();
+
+	uint64_t tail = metadata->data_tail;
+	while (tail < head) {
+		/* Records may wrap around the end of the ring buffer: copy them into a contiguous buffer */
+		uint8_t record[sizeof(struct perf_event_header) + 2 * sizeof(uint64_t)];
+		const size_t record_offset = tail % counter->data_size;
+		struct perf_event_header header;
+		for (size_t i = 0; i < sizeof(header); i++) {
+			((uint8_t*) &header)[i] = counter->data[(record_offset + i) % counter->data_size];
+		}
+		if (header.size == 0) {
+			break;
+		}
+		const size_t record_size = header.size < sizeof(record) ? header.size : sizeof(record);
+		for (size_t i = 0; i < record_size; i++) {
+			record[i] = counter->data[(record_offset + i) % counter->data_size];
+		}
+
+		switch (header.type) {
+			case PERF_RECORD_SAMPLE:
+			{
+				uint64_t ip;
+				memcpy(&ip, &record[sizeof(struct perf_event_header)], sizeof(ip));
+				const uintptr_t offset = (uintptr_t) ip - (uintptr_t) histogram->code;
+				if (offset < histogram->code_size) {
+					histogram->counts[offset]++;
+					histogram->kernel_samples++;
+				} else {
+					histogram->outside_samples++;
+				}
+				break;
+			}
+			case PERF_RECORD_LOST:
+			{
+				/* struct { struct perf_event_header header; u64 id; u64 lost; } */
+				uint64_t lost;
+				memcpy(&lost, &record[sizeof(struct perf_event_header) + sizeof(uint64_t)], sizeof(lost));
+				histogram->lost_samples += lost;
+				break;
+			}
+		}
+		tail += header.size;
+	}
+
+	/* Make sure that all reads complete before the kernel can overwrite the records */
+	__sync_synchronize();
+	metadata->data_tail = tail;
+}
+
+void report_sample_histogram(int connection_socket, const char* name,
+	const struct sample_histogram histogram[restrict static 1])
+{
+	dprintf(connection_socket, "%s samples: %"PRIu64"\n", name, histogram->kernel_samples);
+	dprintf(connection_socket, "%s samples outside kernel: %"PRIu64"\n", name, histogram->outside_samples);
+	if (histogram->lost_samples != 0) {
+		dprintf(connection_socket, "%s lost samples: %"PRIu64"\n", name, histogram->lost_samples);
+	}
+	if (histogram->kernel_samples == 0) {
+		return;
+	}
+
+	/* Find the hottest offsets in the order of decreasing sample count */
+	size_t hotspots[MAX_HOTSPOTS];
+	size_t hotspot_count = 0;
+	for (; hotspot_count < MAX_HOTSPOTS; hotspot_count++) {
+		size_t hottest_offset = SIZE_MAX;
+		uint32_t hottest_count = 0;
+		for (size_t offset = 0; offset < histogram->code_size; offset++) {
+			const uint32_t count = histogram->counts[offset];
+			if (count > hottest_count) {
+				bool reported = false;
+				for (size_t i = 0; i < hotspot_count; i++) {
+					reported |= hotspots[i] == offset;
+				}
+				if (!reported) {
+					hottest_offset = offset;
+					hottest_count = count;
+				}
+			}
+		}
+		if (hottest_offset == SIZE_MAX) {
+			break;
+		}
+		hotspots[hotspot_count] = hottest_offset;
+	}
+
+	size_t region_start = histogram->code_size, region_end = 0;
+	for (size_t i = 0; i < hotspot_count; i++) {
+		const size_t offset = hotspots[i];
+		const uint32_t count = histogram->counts[offset];
+		dprintf(connection_socket, "%s hotspot +0x%04zX: %"PRIu32" (%.1f%%)\n", name, offset, count,
+			100.0 * (double) count / (double) histogram->kernel_samples);
+		if (offset < region_start) {
+			region_start = offset;
+		}
+		if (offset + 1 > region_end) {
+			region_end = offset + 1;
+		}
+	}
+
+	/*
+	 * Report raw bytes of the hot region so that the client can disassemble it with the same listing it generated.
+	 * Note that sampled instruction pointers usually point to the instruction after the one that caused the event.
+	 */
+	region_start = region_start > HOT_REGION_MARGIN ? region_start - HOT_REGION_MARGIN : 0;
+	region_end = region_end + HOT_REGION_MARGIN < histogram->code_size ? region_end + HOT_REGION_MARGIN : histogram->code_size;
+	if (region_end - region_start > MAX_HOT_REGION_SIZE) {
+		region_end = region_start + MAX_HOT_REGION_SIZE;
+	}
+	for (size_t row = region_start; row < region_end; row += 16) {
+		char bytes[16 * 3 + 1] = { 0 };
+		const size_t row_end = row + 16 < region_end ? row + 16 : region_end;
+		for (size_t offset = row; offset < row_end; offset++) {
+			snprintf(&bytes[(offset - row) * 3], 4, " %02"PRIX8, histogram->code[offset]);
+		}
+		dprintf(connection_socket, "%s code +0x%04zX:%s\n", name, row, bytes);
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <linux/perf_event.h>
+
+struct sampling_counter {
+	const char* name;
+	int file_descriptor;
+	/* Metadata page of the perf ring buffer */
+	struct perf_event_mmap_page* metadata;
+	/* Data pages of the perf ring buffer */
+	const uint8_t* data;
+	size_t data_size;
+};
+
+struct sampling_counters {
+	struct sampling_counter* counters;
+	size_t count;
+};
+
+struct sample_histogram {
+	/* Number of samples per byte offset in the code segment */
+	uint32_t* counts;
+	const uint8_t* code;
+	size_t code_size;
+	/* Number of samples with instruction pointer inside the code segment */
+	uint64_t kernel_samples;
+	/* Number of samples with instruction pointer outside the code segment, e.g. in the benchmarking loop */
+	uint64_t outside_samples;
+	/* Number of samples the kernel dropped because the ring buffer was full */
+	uint64_t lost_samples;
+};
+
+/**
+ * @brief Opens sampling performance counters with PERF_SAMPLE_IP and maps their ring buffers.
+ * @details Must be called before the sandbox is enabled, because the sandbox forbids non-anonymous mappings.
+ * @param[in] events_size Size of the @a events string.
+ * @param[in] events      Comma-separated list of event names and event sets to sample. If NULL, only cycles are sampled.
+ * @param[in] period      Number of events between two samples.
+ */
+struct sampling_counters init_sampling_counters(size_t events_size, const char* events, uint64_t period);
+
+/**
+ * @brief Allocates a histogram of samples over the code segment of a kernel.
+ * @param[in] code      Pointer to the start of the code segment.
+ * @param[in] code_size Size of the code segment.
+ */
+struct sample_histogram init_sample_histogram(const void* code, size_t code_size);
+
+/**
+ * @brief Consumes all records in the ring buffer of a sampling counter and adds the samples to the histogram.
+ */
+void drain_sampling_counter(const struct sampling_counter counter[restrict static 1],
+	struct sample_histogram histogram[restrict static 1]);
+
+/**
+ * @brief Writes the hottest code offsets and the bytes of the hot code region to the connection socket.
+ */
+void report_sample_histogram(int connection_socket, const char* name,
+	const struct sample_histogram histogram[restrict static 1]);
@@ -81,6 +81,13 @@ void enable_sandbox(int connection_socket) {
 		BPF_STMT(BPF_RET + BPF_K, SECCOMP_RET_ALLOW),
 		BPF_STMT(BPF_RET + BPF_K, SECCOMP_RET_KILL),
 
+		/* Newer glibc implements fstat through newfstatat(fd, "", buf, AT_EMPTY_PATH) */
+		BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K, __NR_newfstatat, 0, 4),
+		BPF_STMT(BPF_LD + BPF_W + BPF_ABS, SyscallArg(0)),
+		BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K, connection_socket, 0, 1),
+		BPF_STMT(BPF_RET + BPF_K, SECCOMP_RET_ALLOW),
+		BPF_STMT(BPF_RET + BPF_K, SECCOMP_RET_KILL),
+
 		BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K, __NR_ioctl, 0, 1),
 		BPF_STMT(BPF_RET + BPF_K, SECCOMP_RET_ALLOW),
 
@@ -99,7 +106,8 @@ void enable_sandbox(int connection_socket) {
 		.len = sizeof(filter) / sizeof(filter[0]),
 		.filter = filter,
 	};
-	if (prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &prog) == -1) {
+	/* Synchronize the filter to all threads of the process, including measurement threads started before the sandbox */
+	if (syscall(__NR_seccomp, SECCOMP_SET_MODE_FILTER, SECCOMP_FILTER_FLAG_TSYNC, &prog) != 0) {
 		fprintf(stderr, "Error: could not enter seccomp mode (error code %d)\n", errno);
 		_exit(1);
 	}
@@ -0,0 +1,284 @@
+#include <stddef.h>
+#include <stdio.h>
+
+#include <sys/mman.h>
+
+#include <runner/statistics.h>
+
+static const double tail_quantiles[tail_quantile_count] = {
+	[tail_quantile_p90] = 0.9,
+	[tail_quantile_p99] = 0.99,
+	[tail_quantile_p999] = 0.999,
+};
+
+static inline void swap_ulonglong(unsigned long long array[restrict static 1], size_t a, size_t b) {
+	const unsigned long long t = array[a];
+	array[a] = array[b];
+	array[b] = t;
+}
+
+unsigned long long select_order_statistic(unsigned long long array[restrict static 1], size_t length, size_t rank) {
+	/* Quickselect with median-of-three pivots and three-way partitioning, which keeps repeated values linear */
+	size_t left = 0, right = length;
+	while (right - left > 1) {
+		const size_t middle = left + (right - left) / 2;
+		if (array[middle] < array[left]) {
+			swap_ulonglong(array, middle, left);
+		}
+		if (array[right - 1] < array[left]) {
+			swap_ulonglong(array, right - 1, left);
+		}
+		if (array[right - 1] < array[middle]) {
+			swap_ulonglong(array, right - 1, middle);
+		}
+		const unsigned long long pivot = array[middle];
+
+		/* Partition into [left, less) < pivot, [less, i) == pivot, [greater, right) > pivot */
+		size_t less = left, i = left, greater = right;
+		while (i < greater) {
+			if (array[i] < pivot) {
+				swap_ulonglong(array, i++, less++);
+			} else if (array[i] > pivot) {
+				swap_ulonglong(array, i, --greater);
+			} else {
+				i++;
+			}
+		}
+
+		if (rank < less) {
+			right = less;
+		} else if (rank >= greater) {
+			left = greater;
+		} else {
+			return pivot;
+		}
+	}
+	return array[rank];
+}
+
+static inline unsigned long long average(unsigned long long a, unsigned long long b) {
+	return (a / 2) + (b / 2) + (a & b & 1ull);
+}
+
+unsigned long long median(unsigned long long array[], size_t length) {
+	const unsigned long long median_hi = select_order_statistic(array, length, length / 2);
+	if (length % 2 == 0) {
+		/* After selection, the lower middle element is the maximum of the lower half */
+		unsigned long long median_lo = array[0];
+		for (size_t i = 1; i < length / 2; i++) {
+			if (array[i] > median_lo) {
+				median_lo = array[i];
+			}
+		}
+		return average(median_lo, median_hi);
+	} else {
+		return median_hi;
+	}
+}
+
+unsigned long long* allocate_sample_buffer(size_t count) {
+	void* buffer = mmap(NULL, count * MAX_STORED_SAMPLES * sizeof(unsigned long long),
+		PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	return buffer != MAP_FAILED ? (unsigned long long*) buffer : NULL;
+}
+
+void init_p2_quantile(struct p2_quantile estimator[restrict static 1], double quantile) {
+	*estimator = (struct p2_quantile) {
+		.quantile = quantile,
+		.positions = { 1.0, 2.0, 3.0, 4.0, 5.0 },
+		.desired_positions = { 1.0, 1.0 + 2.0 * quantile, 1.0 + 4.0 * quantile, 3.0 + 2.0 * quantile, 5.0 },
+	};
+}
+
+void update_p2_quantile(struct p2_quantile estimator[restrict static 1], double observation) {
+	double* heights = estimator->heights;
+	double* positions = estimator->positions;
+	if (estimator->count < 5) {
+		/* Insertion sort of the first five observations */
+		size_t i = estimator->count++;
+		for (; i != 0 && heights[i - 1] > observation; i--) {
+			heights[i] = heights[i - 1];
+		}
+		heights[i] = observation;
+		return;
+	}
+	estimator->count++;
+
+	/* Find the cell which contains the observation, and extend the extreme markers if needed */
+	size_t cell;
+	if (observation < heights[0]) {
+		heights[0] = observation;
+		cell = 0;
+	} else if (observation >= heights[4]) {
+		heights[4] = observation;
+		cell = 3;
+	} else {
+		cell = 0;
+		while (observation >= heights[cell + 1]) {
+			cell++;
+		}
+	}
+
+	for (size_t i = cell + 1; i < 5; i++) {
+		positions[i] += 1.0;
+	}
+	const double p = estimator->quantile;
+	const double increments[5] = { 0.0, p / 2.0, p, (1.0 + p) / 2.0, 1.0 };
+	for (size_t i = 0; i < 5; i++) {
+		estimator->desired_positions[i] += increments[i];
+	}
+
+	/* Adjust the heights of the middle markers if they are off their desired positions */
+	for (size_t i = 1; i < 4; i++) {
+		const double offset = estimator->desired_positions[i] - positions[i];
+		if ((offset >= 1.0 && positions[i + 1] - positions[i] > 1.0) || (offset <= -1.0 && positions[i - 1] - positions[i] < -1.0)) {
+			const double d = offset >= 0.0 ? 1.0 : -1.0;
+			/* Piecewise-parabolic prediction */
+			const double parabolic = heights[i] + d / (positions[i + 1] - positions[i - 1]) *
+				((positions[i] - positions[i - 1] + d) * (heights[i + 1] - heights[i]) / (positions[i + 1] - positions[i]) +
+				(positions[i + 1] - positions[i] - d) * (heights[i] - heights[i - 1]) / (positions[i] - positions[i - 1]));
+			if (heights[i - 1] < parabolic && parabolic < heights[i + 1]) {
+				heights[i] = parabolic;
+			} else {
+				/* Linear prediction if the parabola is not monotonic */
+				const size_t neighbour = d > 0.0 ? i + 1 : i - 1;
+				heights[i] += d * (heights[neighbour] - heights[i]) / (positions[neighbour] - positions[i]);
+			}
+			positions[i] += d;
+		}
+	}
+}
+
+double get_p2_quantile(const struct p2_quantile estimator[restrict static 1]) {
+	if (estimator->count == 0) {
+		return 0.0;
+	} else if (estimator->count < 5) {
+		/* The first observations are kept sorted */
+		return estimator->heights[(size_t) (estimator->quantile * (double) (estimator->count - 1) + 0.5)];
+	} else {
+		return estimator->heights[2];
+	}
+}
+
+void init_sample_accumulator(struct sample_accumulator accumulator[restrict static 1],
+	unsigned long long buffer[restrict static 1], size_t capacity)
+{
+	*accumulator = (struct sample_accumulator) {
+		.samples = buffer,
+		.capacity = capacity,
+		.random_state = UINT64_C(0x9E3779B97F4A7C15),
+	};
+	for (size_t i = 0; i < tail_quantile_count; i++) {
+		init_p2_quantile(&accumulator->tail_quantiles[i], tail_quantiles[i]);
+	}
+}
+
+void add_sample(struct sample_accumulator accumulator[restrict static 1], unsigned long long sample) {
+	const size_t index = accumulator->count++;
+	if (index < accumulator->capacity) {
+		accumulator->samples[index] = sample;
+	} else {
+		/* Reservoir sampling: replace a random stored sample with probability capacity / count */
+		uint64_t x = accumulator->random_state;
+		x ^= x << 13;
+		x ^= x >> 7;
+		x ^= x << 17;
+		accumulator->random_state = x;
+		const size_t slot = (size_t) (x % accumulator->count);
+		if (slot < accumulator->capacity) {
+			accumulator->samples[slot] = sample;
+		}
+	}
+	for (size_t i = 0; i < tail_quantile_count; i++) {
+		update_p2_quantile(&accumulator->tail_quantiles[i], (double) sample);
+	}
+}
+
+static inline size_t get_stored_sample_count(const struct sample_accumulator accumulator[restrict static 1]) {
+	return accumulator->count < accumulator->capacity ? accumulator->count : accumulator->capacity;
+}
+
+/* Integer square root rounded down */
+static size_t isqrt(size_t n) {
+	size_t root = 0;
+	while ((root + 1) * (root + 1) <= n) {
+		root++;
+	}
+	return root;
+}
+
+double compute_median_precision(struct sample_accumulator accumulator[restrict static 1], unsigned long long overhead) {
+	const size_t count = get_stored_sample_count(accumulator);
+	unsigned long long* samples = accumulator->samples;
+	/*
+	 * Ranks of the order statistics which bound the 95% confidence interval of the median:
+	 * n/2 -+ 1.96 sqrt(n)/2, approximated as n/2 -+ sqrt(n) to round outward.
+	 */
+	const size_t half_width = isqrt(count);
+	const size_t lower_rank = count / 2 > half_width ? count / 2 - half_width : 0;
+	const size_t upper_rank = count / 2 + half_width < count - 1 ? count / 2 + half_width : count - 1;
+	const unsigned long long median_sample = median(samples, count);
+	/* Each selection only reorders elements on one side of the previously selected rank */
+	const unsigned long long lower_sample = select_order_statistic(samples, count / 2 + 1, lower_rank);
+	const unsigned long long upper_sample = upper_rank > count / 2 ?
+		select_order_statistic(&samples[count / 2], count - count / 2, upper_rank - count / 2) : samples[upper_rank];
+	const unsigned long long net_median = median_sample > overhead ? median_sample - overhead : 0;
+	const double width = (double) (upper_sample - lower_sample);
+	if (width == 0.0) {
+		return 0.0;
+	}
+	return 0.5 * width / (double) (net_median != 0 ? net_median : 1);
+}
+
+bool is_sampling_converged(const struct sampling_policy policy[restrict static 1], size_t count,
+	struct sample_accumulator accumulators[restrict static count], const unsigned long long overhead[restrict static count])
+{
+	if (policy->precision == 0.0) {
+		return false;
+	}
+	for (size_t i = 0; i < count; i++) {
+		if (accumulators[i].count < MIN_SAMPLES || compute_median_precision(&accumulators[i], overhead[i]) > policy->precision) {
+			return false;
+		}
+	}
+	return true;
+}
+
+unsigned long long get_sample_quantile(struct sample_accumulator accumulator[restrict static 1], double quantile) {
+	const size_t count = get_stored_sample_count(accumulator);
+	if (count == 0) {
+		return 0;
+	}
+	const size_t rank = (size_t) (quantile * (double) (count - 1) + 0.5);
+	return select_order_statistic(accumulator->samples, count, rank < count ? rank : count - 1);
+}
+
+/* Divides a measurement of several calls by the number of calls, rounding to nearest */
+static inline unsigned long long divide_by_calls(unsigned long long value, size_t calls) {
+	return (value + calls / 2) / calls;
+}
+
+unsigned long long summarize_samples(struct sample_accumulator accumulator[restrict static 1], unsigned long long overhead,
+	size_t calls, struct measurement_statistics statistics[restrict static 1])
+{
+	statistics->samples = accumulator->count;
+	statistics->precision = compute_median_precision(accumulator, overhead);
+	const unsigned long long median_sample = median(accumulator->samples, get_stored_sample_count(accumulator));
+	const unsigned long long net_median = median_sample > overhead ? median_sample - overhead : 0;
+	/* Estimators of different quantiles are independent, so enforce that the estimates do not decrease */
+	unsigned long long previous_quantile = net_median;
+	for (size_t i = 0; i < tail_quantile_count; i++) {
+		const double quantile = get_p2_quantile(&accumulator->tail_quantiles[i]);
+		const unsigned long long net_quantile = quantile > (double) overhead ? (unsigned long long) (quantile - (double) overhead) : 0;
+		previous_quantile = net_quantile > previous_quantile ? net_quantile : previous_quantile;
+		statistics->tail_quantiles[i] = divide_by_calls(previous_quantile, calls);
+	}
+	return divide_by_calls(net_median, calls);
+}
+
+void report_tail_quantiles(int connection_socket, const char* name, const struct measurement_statistics statistics[restrict static 1]) {
+	dprintf(connection_socket, "%s percentiles: p90 %llu, p99 %llu, p99.9 %llu\n", name,
+		statistics->tail_quantiles[tail_quantile_p90],
+		statistics->tail_quantiles[tail_quantile_p99],
+		statistics->tail_quantiles[tail_quantile_p999]);
+}
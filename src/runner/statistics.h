@@ -0,0 +1,182 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include <runner/fence.h>
+
+/* Minimum number of samples before the profiler checks convergence */
+#define MIN_SAMPLES 16
+
+/* Maximum number of samples per measured quantity */
+#define MAX_SAMPLES 10000000
+
+/* Maximum number of samples per measured quantity kept for exact order statistics */
+#define MAX_STORED_SAMPLES 65536
+
+/* Maximum number of kernel calls between two reads of the counters */
+#define MAX_CALLS_PER_SAMPLE 65536
+
+struct sampling_policy {
+	/* Target relative half-width of the 95% confidence interval of the median, or 0 to always take max_samples */
+	double precision;
+	/* CLOCK_MONOTONIC time in nanoseconds after which the profiler stops sampling, or 0 for no deadline */
+	uint64_t deadline;
+	/* Maximum number of samples, at most MAX_SAMPLES */
+	size_t max_samples;
+	/* Number of kernel calls in each sample, at most MAX_CALLS_PER_SAMPLE */
+	size_t calls_per_sample;
+	/* Feed the result of each call into the arguments of the next one to measure latency rather than throughput */
+	bool latency;
+	/* Serialization around the TSC reads which bracket each sample */
+	enum fence_strategy fence;
+};
+
+/* Streaming estimator of a quantile with the P-square algorithm (Jain & Chlamtac, 1985) */
+struct p2_quantile {
+	/* Estimated quantile, between 0 and 1 */
+	double quantile;
+	/* Number of observations */
+	size_t count;
+	/* Heights of the five markers */
+	double heights[5];
+	/* Actual positions of the markers */
+	double positions[5];
+	/* Desired positions of the markers */
+	double desired_positions[5];
+};
+
+enum tail_quantile {
+	tail_quantile_p90,
+	tail_quantile_p99,
+	tail_quantile_p999,
+	tail_quantile_count,
+};
+
+/*
+ * Samples of one measured quantity: a uniform reservoir of at most MAX_STORED_SAMPLES samples for exact order
+ * statistics, and streaming estimators of tail quantiles over all samples.
+ */
+struct sample_accumulator {
+	/* Reservoir of samples */
+	unsigned long long* samples;
+	/* Maximum number of samples in the reservoir */
+	size_t capacity;
+	/* Number of samples added to the accumulator */
+	size_t count;
+	/* State of the random number generator for reservoir sampling */
+	uint64_t random_state;
+	struct p2_quantile tail_quantiles[tail_quantile_count];
+};
+
+struct measurement_statistics {
+	/* Number of samples the statistics were computed from */
+	size_t samples;
+	/* Number of samples dropped because a disturbance event happened during the measurement */
+	size_t rejected_samples;
+	/* Achieved relative half-width of the 95% confidence interval of the median */
+	double precision;
+	/* Estimated tail quantiles, less measurement overhead */
+	unsigned long long tail_quantiles[tail_quantile_count];
+};
+
+static inline uint64_t get_monotonic_nanoseconds(void) {
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return (uint64_t) time.tv_sec * UINT64_C(1000000000) + (uint64_t) time.tv_nsec;
+}
+
+/**
+ * @brief Checks if the profiler may take another sample under the sampling policy.
+ */
+static inline bool is_sampling_allowed(const struct sampling_policy policy[restrict static 1], size_t samples) {
+	if (samples >= policy->max_samples) {
+		return false;
+	}
+	/* Always take the minimum number of samples, even if it breaks the deadline */
+	return samples < MIN_SAMPLES || policy->deadline == 0 || get_monotonic_nanoseconds() < policy->deadline;
+}
+
+/**
+ * @brief Finds the element of the given rank in an array in O(n) expected time.
+ * @details The function partially reorders the array: on return all elements before @a rank are not greater, and all
+ *          elements after @a rank are not smaller than the returned element.
+ * @param[in, out] array  Array of values.
+ * @param[in]      length Number of elements in the array.
+ * @param[in]      rank   Zero-based rank of the element to find, less than @a length.
+ */
+unsigned long long select_order_statistic(unsigned long long array[restrict static 1], size_t length, size_t rank);
+
+/**
+ * @brief Computes the median of an array in O(n) expected time. The array is partially reordered.
+ */
+unsigned long long median(unsigned long long array[], size_t length);
+
+/**
+ * @brief Allocates memory for sample reservoirs with an anonymous mapping, which the sandbox permits.
+ * @param[in] count Number of reservoirs of MAX_STORED_SAMPLES samples.
+ * @return Pointer to the memory, or NULL if the allocation failed.
+ */
+unsigned long long* allocate_sample_buffer(size_t count);
+
+void init_p2_quantile(struct p2_quantile estimator[restrict static 1], double quantile);
+void update_p2_quantile(struct p2_quantile estimator[restrict static 1], double observation);
+double get_p2_quantile(const struct p2_quantile estimator[restrict static 1]);
+
+/**
+ * @brief Initializes an empty accumulator of samples.
+ * @param[out] accumulator Accumulator to initialize.
+ * @param[in]  buffer      Memory for the reservoir of samples.
+ * @param[in]  capacity    Number of samples which fit into the @a buffer.
+ */
+void init_sample_accumulator(struct sample_accumulator accumulator[restrict static 1],
+	unsigned long long buffer[restrict static 1], size_t capacity);
+
+/**
+ * @brief Adds a sample to the reservoir and to the streaming estimators of the accumulator.
+ */
+void add_sample(struct sample_accumulator accumulator[restrict static 1], unsigned long long sample);
+
+/**
+ * @brief Computes the relative half-width of the distribution-free 95% confidence interval of the median.
+ * @details The confidence interval is bounded by order statistics, so the function reorders the reservoir.
+ * @param[in, out] accumulator Accumulated samples.
+ * @param[in]      overhead    Measurement overhead, which is subtracted from the median before computing relative error.
+ */
+double compute_median_precision(struct sample_accumulator accumulator[restrict static 1], unsigned long long overhead);
+
+/**
+ * @brief Checks if the medians of all measured quantities reached the precision target of the sampling policy.
+ * @param[in]      policy       Sampling policy with the precision target.
+ * @param[in]      count        Number of measured quantities.
+ * @param[in, out] accumulators Accumulated samples of each quantity.
+ * @param[in]      overhead     Measurement overhead for each quantity.
+ */
+bool is_sampling_converged(const struct sampling_policy policy[restrict static 1], size_t count,
+	struct sample_accumulator accumulators[restrict static count], const unsigned long long overhead[restrict static count]);
+
+/**
+ * @brief Computes a quantile of the samples in the reservoir. The reservoir is partially reordered.
+ * @param[in, out] accumulator Accumulated samples.
+ * @param[in]      quantile    Quantile between 0 and 1.
+ * @return Sample of the nearest rank, or 0 if the accumulator is empty.
+ */
+unsigned long long get_sample_quantile(struct sample_accumulator accumulator[restrict static 1], double quantile);
+
+/**
+ * @brief Computes the median, its precision, and tail quantiles of accumulated samples.
+ * @param[in, out] accumulator Accumulated samples.
+ * @param[in]      overhead    Measurement overhead to subtract.
+ * @param[in]      calls       Number of kernel calls per sample. The median and tail quantiles are divided by it.
+ * @param[out]     statistics  Sample count, precision and tail quantiles per call.
+ * @return Median of the samples per call, less measurement overhead.
+ */
+unsigned long long summarize_samples(struct sample_accumulator accumulator[restrict static 1], unsigned long long overhead,
+	size_t calls, struct measurement_statistics statistics[restrict static 1]);
+
+/**
+ * @brief Writes the tail quantiles of a measured quantity to the connection socket as a single line.
+ */
+void report_tail_quantiles(int connection_socket, const char* name, const struct measurement_statistics statistics[restrict static 1]);
@@ -0,0 +1,139 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <sched.h>
+#include <immintrin.h>
+
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include <webserver/logs.h>
+#include <runner/threads.h>
+
+void init_spin_barrier(struct spin_barrier barrier[restrict static 1], size_t count) {
+	barrier->count = count;
+	atomic_init(&barrier->arrived, 0);
+	atomic_init(&barrier->generation, 0);
+}
+
+void wait_spin_barrier(struct spin_barrier barrier[restrict static 1], bool block) {
+	const uint32_t generation = atomic_load_explicit(&barrier->generation, memory_order_acquire);
+	if (atomic_fetch_add_explicit(&barrier->arrived, 1, memory_order_acq_rel) + 1 == barrier->count) {
+		/* The last thread resets the counter for the next generation before it releases the other threads */
+		atomic_store_explicit(&barrier->arrived, 0, memory_order_relaxed);
+		atomic_fetch_add_explicit(&barrier->generation, 1, memory_order_release);
+		if (block) {
+			syscall(__NR_futex, &barrier->generation, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+		}
+	} else if (block) {
+		/* The futex returns at once if the generation already changed, so a wake-up can not be missed */
+		while (atomic_load_explicit(&barrier->generation, memory_order_acquire) == generation) {
+			syscall(__NR_futex, &barrier->generation, FUTEX_WAIT_PRIVATE, generation, NULL, NULL, 0);
+		}
+	} else {
+		while (atomic_load_explicit(&barrier->generation, memory_order_acquire) == generation) {
+			_mm_pause();
+		}
+	}
+}
+
+/* One logical processor on each physical core of the selected package */
+static int core_cpus[MAX_THREADS];
+static size_t core_cpu_count = 0;
+
+static bool read_topology_id(int cpu, const char* name, int id[restrict static 1]) {
+	char path[128];
+	snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/%s", cpu, name);
+	FILE* file = fopen(path, "r");
+	if (file == NULL) {
+		return false;
+	}
+	const bool parsed = fscanf(file, "%d", id) == 1;
+	fclose(file);
+	return parsed;
+}
+
+size_t init_cpu_topology(void) {
+	cpu_set_t cpu_set;
+	CPU_ZERO(&cpu_set);
+	if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) != 0) {
+		log_fatal("failed to get CPU affinity: %s\n", strerror(errno));
+	}
+
+	/* The first allowed logical processor of each physical core, with its package */
+	static int cpus[CPU_SETSIZE], packages[CPU_SETSIZE], cores[CPU_SETSIZE];
+	size_t count = 0;
+	for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+		if (!CPU_ISSET(cpu, &cpu_set)) {
+			continue;
+		}
+		int package, core;
+		if (!read_topology_id(cpu, "physical_package_id", &package) || !read_topology_id(cpu, "core_id", &core)) {
+			/* Without topology information, count each processor as a core of its own */
+			package = 0;
+			core = -1 - cpu;
+		}
+		bool sibling = false;
+		for (size_t i = 0; i < count && !sibling; i++) {
+			sibling = packages[i] == package && cores[i] == core;
+		}
+		if (!sibling) {
+			cpus[count] = cpu;
+			packages[count] = package;
+			cores[count] = core;
+			count++;
+		}
+	}
+
+	/* Pick the package with the most cores; on a tie, the package of the lowest-numbered processor */
+	int best_package = count != 0 ? packages[0] : 0;
+	size_t best_cores = 0;
+	for (size_t i = 0; i < count; i++) {
+		size_t package_cores = 0;
+		for (size_t j = 0; j < count; j++) {
+			package_cores += packages[j] == packages[i];
+		}
+		if (package_cores > best_cores) {
+			best_package = packages[i];
+			best_cores = package_cores;
+		}
+	}
+	core_cpu_count = 0;
+	for (size_t i = 0; i < count && core_cpu_count < MAX_THREADS; i++) {
+		if (packages[i] == best_package) {
+			core_cpus[core_cpu_count++] = cpus[i];
+		}
+	}
+	return core_cpu_count;
+}
+
+size_t get_core_cpus(size_t max_count, int cpus[restrict static max_count]) {
+	const size_t count = core_cpu_count < max_count ? core_cpu_count : max_count;
+	memcpy(cpus, core_cpus, count * sizeof(int));
+	return count;
+}
+
+size_t get_core_cpu_count(void) {
+	return core_cpu_count;
+}
+
+void pin_thread(int cpu) {
+	cpu_set_t cpu_set;
+	CPU_ZERO(&cpu_set);
+	CPU_SET(cpu, &cpu_set);
+	if (sched_setaffinity(0, sizeof(cpu_set), &cpu_set) != 0) {
+		log_fatal("failed to pin thread to CPU %d: %s\n", cpu, strerror(errno));
+	}
+}
+
+noreturn void park_thread(void) {
+	/* The futex word never changes, so every wait blocks until a signal or the process exit */
+	static const uint32_t futex_word = 0;
+	for (;;) {
+		syscall(__NR_futex, &futex_word, FUTEX_WAIT_PRIVATE, 0, NULL, NULL, 0);
+	}
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <stdnoreturn.h>
+
+/* Maximum number of threads which call a kernel in parallel */
+#define MAX_THREADS 64
+
+/* Barrier which waiting threads spin on, so that they leave it within nanoseconds of each other */
+struct spin_barrier {
+	/* Number of threads which synchronize on the barrier */
+	size_t count;
+	/* Number of threads which arrived at the barrier in the current generation */
+	atomic_size_t arrived;
+	/* Number of times all threads passed the barrier; 32 bits wide, so that blocked threads can wait on it with futex */
+	_Atomic uint32_t generation;
+};
+
+/**
+ * @brief Initializes a barrier for the specified number of threads.
+ */
+void init_spin_barrier(struct spin_barrier barrier[restrict static 1], size_t count);
+
+/**
+ * @brief Waits until all threads arrive at the barrier.
+ * @details The barrier makes memory writes before the call visible to all threads after the call, and can be reused.
+ *          Spinning threads leave the barrier within nanoseconds of each other; blocked threads sleep in futex, which
+ *          the sandbox allows, and use no CPU time while they wait.
+ * @param[in] block Sleep instead of spinning. All threads must pass the same value at the same barrier generation.
+ */
+void wait_spin_barrier(struct spin_barrier barrier[restrict static 1], bool block);
+
+/**
+ * @brief Selects one logical processor on each physical core of one package for parallel measurements.
+ * @details Reads the package and core of every allowed processor from /sys/devices/system/cpu/cpu*\/topology, and
+ *          picks the package with the most allowed cores, so that threads share neither a core nor the interconnect
+ *          between packages. Must be called before the sandbox is enabled.
+ * @return Number of selected processors.
+ */
+size_t init_cpu_topology(void);
+
+/**
+ * @brief Lists the logical processors selected by init_cpu_topology.
+ * @param[in]  max_count Maximum number of processors to list.
+ * @param[out] cpus      Indices of the processors, in increasing order.
+ * @return Number of listed processors, at most @a max_count.
+ */
+size_t get_core_cpus(size_t max_count, int cpus[restrict static max_count]);
+
+/**
+ * @brief Returns the number of logical processors selected by init_cpu_topology, at most MAX_THREADS.
+ */
+size_t get_core_cpu_count(void);
+
+/**
+ * @brief Restricts the calling thread to one logical processor.
+ * @details Must be called before the sandbox is enabled, because the sandbox forbids sched_setaffinity.
+ *          Aborts if the thread can not be pinned.
+ */
+void pin_thread(int cpu);
+
+/**
+ * @brief Blocks the calling thread until the process exits.
+ * @details Threads must not return after the sandbox is enabled: thread exit in glibc releases the thread stack
+ *          with system calls the sandbox forbids.
+ */
+noreturn void park_thread(void);
@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include <webserver/logs.h>
+#include <runner/timing.h>
+
+/* Duration of TSC calibration against CLOCK_MONOTONIC_RAW, in nanoseconds */
+#define TSC_CALIBRATION_TIME 20000000
+
+static uint64_t tsc_frequency = 0;
+
+static uint64_t read_monotonic_raw_nanoseconds(void) {
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC_RAW, &time);
+	return (uint64_t) time.tv_sec * UINT64_C(1000000000) + (uint64_t) time.tv_nsec;
+}
+
+static uint64_t get_cpuid_tsc_frequency(void) {
+	uint32_t max_leaf, eax, ebx, ecx, edx;
+	__cpuid(0, max_leaf, ebx, ecx, edx);
+	if (max_leaf < 0x15) {
+		return 0;
+	}
+	/* Leaf 0x15: TSC / crystal clock ratio in EBX / EAX and crystal clock frequency in ECX */
+	__cpuid(0x15, eax, ebx, ecx, edx);
+	if (eax == 0 || ebx == 0 || ecx == 0) {
+		return 0;
+	}
+	return (uint64_t) ecx * ebx / eax;
+}
+
+uint64_t init_tsc_frequency(void) {
+	uint32_t max_extended_leaf, eax, ebx, ecx, edx;
+	__cpuid(0x80000000, max_extended_leaf, ebx, ecx, edx);
+	bool invariant_tsc = false;
+	if (max_extended_leaf >= 0x80000007) {
+		__cpuid(0x80000007, eax, ebx, ecx, edx);
+		invariant_tsc = !!(edx & (UINT32_C(1) << 8));
+	}
+	if (!invariant_tsc) {
+		log_error("TSC is not invariant: TSC ticks may not correspond to wall time\n");
+	}
+
+	tsc_frequency = get_cpuid_tsc_frequency();
+	if (tsc_frequency == 0) {
+		const uint64_t start_nanoseconds = read_monotonic_raw_nanoseconds();
+		const uint64_t start_tsc = read_tsc_start();
+		uint64_t end_nanoseconds;
+		do {
+			end_nanoseconds = read_monotonic_raw_nanoseconds();
+		} while (end_nanoseconds - start_nanoseconds < TSC_CALIBRATION_TIME);
+		const uint64_t end_tsc = read_tsc_start();
+		tsc_frequency = (uint64_t) ((double) (end_tsc - start_tsc) * 1.0e+9 / (double) (end_nanoseconds - start_nanoseconds));
+	}
+	return tsc_frequency;
+}
+
+struct timing_backend init_timing_backend(void) {
+	struct perf_event_attr perf_event_attr;
+	memset(&perf_event_attr, 0, sizeof(perf_event_attr));
+	perf_event_attr.type = PERF_TYPE_SOFTWARE;
+	perf_event_attr.size = sizeof(perf_event_attr);
+	perf_event_attr.config = PERF_COUNT_SW_TASK_CLOCK;
+	perf_event_attr.exclude_kernel = 1;
+	perf_event_attr.exclude_hv = 1;
+
+	return (struct timing_backend) {
+		.task_clock_file_descriptor = syscall(__NR_perf_event_open, &perf_event_attr, 0, -1, -1, 0),
+		.tsc_frequency = tsc_frequency,
+	};
+}
+
+void report_timing_counts(int connection_socket, const struct timing_backend backend[restrict static 1],
+	const struct timing_counts counts[restrict static 1], const struct measurement_statistics statistics[restrict static 1])
+{
+	dprintf(connection_socket, "Backend: timing (%s)\n",
+		backend->task_clock_file_descriptor != -1 ? "task clock" : "CLOCK_MONOTONIC_RAW");
+	dprintf(connection_socket, "TSC ticks: %llu (+/-%.1f%%, %zu samples)\n", counts->tsc_ticks,
+		100.0 * statistics->precision, statistics->samples);
+	report_tail_quantiles(connection_socket, "TSC ticks", statistics);
+	if (backend->tsc_frequency != 0) {
+		dprintf(connection_socket, "TSC frequency: %"PRIu64" kHz\n", backend->tsc_frequency / 1000);
+		dprintf(connection_socket, "Time (ns): %llu\n",
+			(unsigned long long) ((double) counts->tsc_ticks * 1.0e+9 / (double) backend->tsc_frequency));
+	}
+	dprintf(connection_socket, "%s (ns): %llu\n",
+		backend->task_clock_file_descriptor != -1 ? "Task clock" : "Monotonic clock", counts->clock_nanoseconds);
+}
+
+void report_reference_timing(int connection_socket, const char name[restrict static 1],
+	const struct timing_counts counts[restrict static 1], const struct measurement_statistics statistics[restrict static 1],
+	unsigned long long tsc_ticks)
+{
+	dprintf(connection_socket, "Reference: %s\n", name);
+	dprintf(connection_socket, "Reference TSC ticks: %llu (+/-%.1f%%, %zu samples)\n", counts->tsc_ticks,
+		100.0 * statistics->precision, statistics->samples);
+	if (tsc_ticks != 0) {
+		dprintf(connection_socket, "Speedup over reference: %.3lf (TSC ticks)\n", (double) counts->tsc_ticks / (double) tsc_ticks);
+	}
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <cpuid.h>
+#include <x86intrin.h>
+
+#include <unistd.h>
+
+#include <runner/statistics.h>
+
+struct timing_backend {
+	/* File descriptor of a PERF_COUNT_SW_TASK_CLOCK counter, or -1 if CLOCK_MONOTONIC_RAW is used instead */
+	int task_clock_file_descriptor;
+	/* TSC frequency in Hz, or 0 if unknown */
+	uint64_t tsc_frequency;
+};
+
+struct timing_counts {
+	/* TSC ticks per kernel call */
+	unsigned long long tsc_ticks;
+	/* Nanoseconds per kernel call according to the task clock or CLOCK_MONOTONIC_RAW */
+	unsigned long long clock_nanoseconds;
+};
+
+/* Quantities the timing backend samples on every kernel call */
+enum timing_quantity {
+	timing_quantity_tsc_ticks,
+	timing_quantity_clock_nanoseconds,
+	timing_quantity_count,
+};
+
+/**
+ * @brief Determines the TSC frequency from CPUID or by calibration against CLOCK_MONOTONIC_RAW.
+ * @details Calibration takes a few milliseconds, so the function should be called once at server startup.
+ *          The result is cached and inherited by the request processes.
+ * @return TSC frequency in Hz, or 0 if the processor has no usable TSC.
+ */
+uint64_t init_tsc_frequency(void);
+
+/**
+ * @brief Opens the clock sources for the timing backend.
+ * @details Must be called before the sandbox is enabled, because the sandbox forbids perf_event_open.
+ */
+struct timing_backend init_timing_backend(void);
+
+/**
+ * @brief Reads the TSC at the start of a measured region.
+ * @details CPUID waits for all preceding instructions to retire before RDTSC executes.
+ */
+static inline uint64_t read_tsc_start(void) {
+	uint32_t eax, ebx, ecx, edx;
+	__cpuid(0, eax, ebx, ecx, edx);
+	return __rdtsc();
+}
+
+/**
+ * @brief Reads the clock of the timing backend in nanoseconds.
+ * @return true if the clock was read, false otherwise.
+ */
+static inline bool read_timing_clock(const struct timing_backend backend[restrict static 1], uint64_t nanoseconds[restrict static 1]) {
+	if (backend->task_clock_file_descriptor != -1) {
+		return read(backend->task_clock_file_descriptor, nanoseconds, sizeof(uint64_t)) == sizeof(uint64_t);
+	} else {
+		struct timespec time;
+		if (clock_gettime(CLOCK_MONOTONIC_RAW, &time) != 0) {
+			return false;
+		}
+		*nanoseconds = (uint64_t) time.tv_sec * UINT64_C(1000000000) + (uint64_t) time.tv_nsec;
+		return true;
+	}
+}
+
+/**
+ * @brief Writes the timing backend description and the measured timings to the connection socket.
+ */
+void report_timing_counts(int connection_socket, const struct timing_backend backend[restrict static 1],
+	const struct timing_counts counts[restrict static 1], const struct measurement_statistics statistics[restrict static 1]);
+
+/**
+ * @brief Writes the timing of a reference implementation and the speedup of the submitted kernel over it.
+ * @param[in] name      Description of the reference implementation.
+ * @param[in] counts    Timings of the reference implementation.
+ * @param[in] tsc_ticks TSC ticks per call of the submitted kernel.
+ */
+void report_reference_timing(int connection_socket, const char name[restrict static 1],
+	const struct timing_counts counts[restrict static 1], const struct measurement_statistics statistics[restrict static 1],
+	unsigned long long tsc_ticks);
@@ -0,0 +1,92 @@
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+
+#include <runner/perfctr.h>
+
+static double clamp(double value, double max) {
+	if (value < 0.0) {
+		return 0.0;
+	} else if (value > max) {
+		return max;
+	} else {
+		return value;
+	}
+}
+
+bool compute_tma_metrics(const struct performance_counters performance_counters[restrict static 1],
+	const unsigned long long counts[restrict static 1], struct tma_metrics metrics[restrict static 1])
+{
+	const struct tma_specification* tma = performance_counters->tma;
+	if (tma == NULL) {
+		return false;
+	}
+
+	double events[tma_event_count];
+	for (size_t event = 0; event < tma_event_count; event++) {
+		bool found = false;
+		for (size_t i = 0; i < performance_counters->count; i++) {
+			if (counts[i] != ULLONG_MAX && strcmp(performance_counters->counters[i].name, tma->events[event]) == 0) {
+				events[event] = (double) counts[i];
+				found = true;
+				break;
+			}
+		}
+		if (!found) {
+			return false;
+		}
+	}
+
+	const double width = (double) tma->pipeline_width;
+	const double slots = width * events[tma_event_cycles];
+	if (slots == 0.0) {
+		return false;
+	}
+
+	/* Level 1: every issue slot is either used by a retired uop, wasted on a mis-speculated uop, or stalled */
+	metrics->frontend_bound = clamp(events[tma_event_undelivered_uops] / slots, 1.0);
+	metrics->bad_speculation = clamp((events[tma_event_uops_issued] - events[tma_event_retire_slots] +
+		width * events[tma_event_recovery_cycles]) / slots, 1.0);
+	metrics->retiring = clamp(events[tma_event_retire_slots] / slots, 1.0);
+	metrics->backend_bound = clamp(1.0 - (metrics->frontend_bound + metrics->bad_speculation + metrics->retiring), 1.0);
+
+	/* Front-end: cycles without any delivered uops are attributed to latency, the rest to bandwidth */
+	metrics->frontend_latency = clamp(width * events[tma_event_undelivered_cycles] / slots, metrics->frontend_bound);
+	metrics->frontend_bandwidth = metrics->frontend_bound - metrics->frontend_latency;
+
+	/* Bad speculation: split in proportion to the number of mispredicts and machine clears */
+	const double speculation_events = events[tma_event_branch_mispredicts] + events[tma_event_machine_clears];
+	metrics->branch_mispredicts = speculation_events != 0.0 ?
+		metrics->bad_speculation * events[tma_event_branch_mispredicts] / speculation_events : 0.0;
+	metrics->machine_clears = metrics->bad_speculation - metrics->branch_mispredicts;
+
+	/* Retiring: uops from the microcode sequencer, scaled by the fraction of issued uops which retired */
+	const double retired_fraction = events[tma_event_uops_issued] != 0.0 ?
+		events[tma_event_retire_slots] / events[tma_event_uops_issued] : 0.0;
+	metrics->microcode_sequencer =
+		clamp(retired_fraction * events[tma_event_microcode_uops] / slots, metrics->retiring);
+	metrics->base = metrics->retiring - metrics->microcode_sequencer;
+
+	/* Back-end: fraction of execution and store buffer stalls with a pending memory access */
+	const double backend_stalls = events[tma_event_execution_stalls] + events[tma_event_store_buffer_stalls];
+	metrics->memory_bound = backend_stalls != 0.0 ? clamp(metrics->backend_bound *
+		(events[tma_event_memory_stalls] + events[tma_event_store_buffer_stalls]) / backend_stalls,
+		metrics->backend_bound) : 0.0;
+	metrics->core_bound = metrics->backend_bound - metrics->memory_bound;
+	return true;
+}
+
+void report_tma_metrics(int connection_socket, const struct tma_metrics metrics[restrict static 1]) {
+	dprintf(connection_socket, "Frontend_Bound: %.1f%%\n", 100.0 * metrics->frontend_bound);
+	dprintf(connection_socket, "Frontend_Bound.Frontend_Latency: %.1f%%\n", 100.0 * metrics->frontend_latency);
+	dprintf(connection_socket, "Frontend_Bound.Frontend_Bandwidth: %.1f%%\n", 100.0 * metrics->frontend_bandwidth);
+	dprintf(connection_socket, "Bad_Speculation: %.1f%%\n", 100.0 * metrics->bad_speculation);
+	dprintf(connection_socket, "Bad_Speculation.Branch_Mispredicts: %.1f%%\n", 100.0 * metrics->branch_mispredicts);
+	dprintf(connection_socket, "Bad_Speculation.Machine_Clears: %.1f%%\n", 100.0 * metrics->machine_clears);
+	dprintf(connection_socket, "Retiring: %.1f%%\n", 100.0 * metrics->retiring);
+	dprintf(connection_socket, "Retiring.Base: %.1f%%\n", 100.0 * metrics->base);
+	dprintf(connection_socket, "Retiring.Microcode_Sequencer: %.1f%%\n", 100.0 * metrics->microcode_sequencer);
+	dprintf(connection_socket, "Backend_Bound: %.1f%%\n", 100.0 * metrics->backend_bound);
+	dprintf(connection_socket, "Backend_Bound.Memory_Bound: %.1f%%\n", 100.0 * metrics->memory_bound);
+	dprintf(connection_socket, "Backend_Bound.Core_Bound: %.1f%%\n", 100.0 * metrics->core_bound);
+}
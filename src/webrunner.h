@@ -9,9 +9,19 @@ enum webrunner_command {
 	webrunner_command_invalid = 0,
 	webrunner_command_monitor,
 	webrunner_command_run,
+	webrunner_command_calibration,
+};
+
+enum webrunner_profile_mode {
+	webrunner_profile_mode_invalid = 0,
+	/* Count events with performance counters */
+	webrunner_profile_mode_count,
+	/* Sample instruction pointers on overflow of performance counters */
+	webrunner_profile_mode_sample,
 };
 
 enum webrunner_command parse_webrunner_command(size_t command_size, const char command[restrict static command_size]);
+enum webrunner_profile_mode parse_webrunner_profile_mode(size_t mode_size, const char mode[restrict static mode_size]);
 
 /**
  * @brief Loads ELF image into memory, and finds the specified function by name.
@@ -21,9 +31,10 @@ enum webrunner_command parse_webrunner_command(size_t command_size, const char c
  * @param[in] elf_image     Pointer to the ELF image.
  * @param[in] image_size    Size of the ELF image.
  * @param[in] function_name Name of the function to locate after loading the ELF image.
+ * @param[out] code_size    Size of the executable segment.
  * @return Pointer to the function with name @a function_name in executable segment.
  */
-generic_function load_kernel(const void* elf_image, size_t image_size, const char* function_name);
+generic_function load_kernel(const void* elf_image, size_t image_size, const char* function_name, size_t code_size[restrict static 1]);
 
 void process_request(int connection_socket);
 
@@ -40,6 +40,13 @@ void log_access(const char* format, ...) {
 	va_end(args);
 }
 
+void log_info(const char* format, ...) {
+	va_list args;
+	va_start(args, format);
+	log_message(error_log_fd, format, args);
+	va_end(args);
+}
+
 void log_error(const char* format, ...) {
 	va_list args;
 	va_start(args, format);
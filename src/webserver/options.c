@@ -18,6 +18,8 @@ struct options parse_options(int argc, char** argv) {
 		.error_log = STDERR_FILENO,
 		.port = 8081,
 		.queue_size = 10,
+		.events_directory = NULL,
+		.calibration_interval = 600,
 	};
 	for (int argi = 1; argi < argc; argi += 1) {
 		if (strcmp(argv[argi], "--access-log") == 0) {
@@ -72,6 +74,25 @@ struct options parse_options(int argc, char** argv) {
 				exit(EXIT_FAILURE);
 			}
 			argi += 1;
+		} else if (strcmp(argv[argi], "--events-dir") == 0) {
+			if (argi + 1 == argc) {
+				fprintf(stderr, "Error: expected 'events-dir' argument\n");
+				print_options_help(argv[0]);
+				exit(EXIT_FAILURE);
+			}
+			options.events_directory = argv[argi + 1];
+			argi += 1;
+		} else if (strcmp(argv[argi], "--calibration-interval") == 0) {
+			if (argi + 1 == argc) {
+				fprintf(stderr, "Error: expected 'calibration-interval' argument\n");
+				print_options_help(argv[0]);
+				exit(EXIT_FAILURE);
+			}
+			if (sscanf(argv[argi + 1], "%"SCNu32, &options.calibration_interval) != 1) {
+				fprintf(stderr, "Error: failed to parse %s as unsigned decimal number\n", argv[argi + 1]);
+				exit(EXIT_FAILURE);
+			}
+			argi += 1;
 		} else if ((strcmp(argv[argi], "--help") == 0) || (strcmp(argv[argi], "-h") == 0)) {
 			print_options_help(argv[0]);
 			exit(EXIT_SUCCESS);
@@ -91,4 +112,6 @@ void print_options_help(const char* program_name) {
 	printf("      --error-log   The filename for the error log (default: stderr)\n");
 	printf("  -p  --port        The TCP/IP port to listen on (default: 8081)\n");
 	printf("  -q  --queue-size  The size of queue for the listening socket (default: 10)\n");
+	printf("      --events-dir  The directory with perfmon JSON event files and mapfile.csv (default: built-in tables)\n");
+	printf("      --calibration-interval  The interval in seconds between calibrations of measurement overhead (default: 600)\n");
 }
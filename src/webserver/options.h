@@ -8,6 +8,8 @@ struct options {
 	int error_log;
 	uint16_t port;
 	uint32_t queue_size;
+	const char* events_directory;
+	uint32_t calibration_interval;
 };
 
 struct options parse_options(int argc, char** argv);
@@ -17,15 +17,133 @@ enum webrunner_command parse_webrunner_command(size_t command_size, const char c
 				return webrunner_command_monitor;
 			}
 			break;
+		case sizeof("calibration") - 1:
+			if (memcmp(command, "calibration", command_size) == 0) {
+				return webrunner_command_calibration;
+			}
+			break;
 	}
 	return webrunner_command_invalid;
 }
 
+enum webrunner_profile_mode parse_webrunner_profile_mode(size_t mode_size, const char mode[restrict static mode_size]) {
+	switch (mode_size) {
+		case sizeof("count") - 1:
+			if (memcmp(mode, "count", mode_size) == 0) {
+				return webrunner_profile_mode_count;
+			}
+			break;
+		case sizeof("sample") - 1:
+			if (memcmp(mode, "sample", mode_size) == 0) {
+				return webrunner_profile_mode_sample;
+			}
+			break;
+	}
+	return webrunner_profile_mode_invalid;
+}
+
+enum cache_mode parse_cache_mode(size_t mode_size, const char mode[restrict static mode_size]) {
+	switch (mode_size) {
+		case sizeof("warm") - 1:
+			if (memcmp(mode, "warm", mode_size) == 0) {
+				return cache_mode_warm;
+			} else if (memcmp(mode, "cold", mode_size) == 0) {
+				return cache_mode_cold;
+			}
+			break;
+		case sizeof("rotate") - 1:
+			if (memcmp(mode, "rotate", mode_size) == 0) {
+				return cache_mode_rotate;
+			}
+			break;
+	}
+	return cache_mode_invalid;
+}
+
+enum sweep_mode parse_sweep_mode(size_t mode_size, const char mode[restrict static mode_size]) {
+	switch (mode_size) {
+		case sizeof("none") - 1:
+			if (memcmp(mode, "none", mode_size) == 0) {
+				return sweep_mode_none;
+			}
+			break;
+		case sizeof("cache") - 1:
+			if (memcmp(mode, "cache", mode_size) == 0) {
+				return sweep_mode_cache;
+			}
+			break;
+	}
+	return sweep_mode_invalid;
+}
+
+enum fence_strategy parse_fence_strategy(size_t strategy_size, const char strategy[restrict static strategy_size]) {
+	switch (strategy_size) {
+		case sizeof("cpuid") - 1:
+			if (memcmp(strategy, "cpuid", strategy_size) == 0) {
+				return fence_strategy_cpuid;
+			}
+			break;
+		case sizeof("lfence") - 1:
+			if (memcmp(strategy, "lfence", strategy_size) == 0) {
+				return fence_strategy_lfence;
+			} else if (memcmp(strategy, "rdtscp", strategy_size) == 0) {
+				return fence_strategy_rdtscp;
+			}
+			break;
+		case sizeof("serialize") - 1:
+			if (memcmp(strategy, "serialize", strategy_size) == 0) {
+				return fence_strategy_serialize;
+			}
+			break;
+	}
+	return fence_strategy_invalid;
+}
+
 enum webrunner_parameter parse_webrunner_parameter(size_t parameter_size, const char parameter[restrict static parameter_size]) {
 	switch (parameter_size) {
 		case sizeof("kernel") - 1:
 			if (memcmp(parameter, "kernel", parameter_size) == 0) {
 				return webrunner_parameter_kernel;
+			} else if (memcmp(parameter, "events", parameter_size) == 0) {
+				return webrunner_parameter_events;
+			} else if (memcmp(parameter, "period", parameter_size) == 0) {
+				return webrunner_parameter_period;
+			} else if (memcmp(parameter, "warmup", parameter_size) == 0) {
+				return webrunner_parameter_warmup;
+			}
+			break;
+		case sizeof("cache") - 1:
+			if (memcmp(parameter, "cache", parameter_size) == 0) {
+				return webrunner_parameter_cache;
+			} else if (memcmp(parameter, "fence", parameter_size) == 0) {
+				return webrunner_parameter_fence;
+			} else if (memcmp(parameter, "sweep", parameter_size) == 0) {
+				return webrunner_parameter_sweep;
+			}
+			break;
+		case sizeof("precision") - 1:
+			if (memcmp(parameter, "precision", parameter_size) == 0) {
+				return webrunner_parameter_precision;
+			} else if (memcmp(parameter, "budget_ms", parameter_size) == 0) {
+				return webrunner_parameter_budget_ms;
+			} else if (memcmp(parameter, "max_drift", parameter_size) == 0) {
+				return webrunner_parameter_max_drift;
+			}
+			break;
+		case sizeof("profile") - 1:
+			if (memcmp(parameter, "profile", parameter_size) == 0) {
+				return webrunner_parameter_profile;
+			} else if (memcmp(parameter, "samples", parameter_size) == 0) {
+				return webrunner_parameter_samples;
+			} else if (memcmp(parameter, "latency", parameter_size) == 0) {
+				return webrunner_parameter_latency;
+			} else if (memcmp(parameter, "threads", parameter_size) == 0) {
+				return webrunner_parameter_threads;
+			}
+			break;
+		case sizeof("calls_per_sample") - 1:
+			if (memcmp(parameter, "calls_per_sample", parameter_size) == 0) {
+				return webrunner_parameter_calls_per_sample;
 			}
 			break;
 	}
@@ -59,3 +177,31 @@ bool parse_uint64(size_t string_size, const char string[restrict static string_s
 	cstring[string_size] = '\0';
 	return sscanf(cstring, "%"SCNu64, value) == 1;
 }
+
+bool parse_int32(size_t string_size, const char string[restrict static string_size], int32_t value[restrict static 1]) {
+	char cstring[string_size + 1];
+	memcpy(cstring, string, string_size);
+	cstring[string_size] = '\0';
+	return sscanf(cstring, "%"SCNd32, value) == 1;
+}
+
+bool parse_int64(size_t string_size, const char string[restrict static string_size], int64_t value[restrict static 1]) {
+	char cstring[string_size + 1];
+	memcpy(cstring, string, string_size);
+	cstring[string_size] = '\0';
+	return sscanf(cstring, "%"SCNd64, value) == 1;
+}
+
+bool parse_float(size_t string_size, const char string[restrict static string_size], float value[restrict static 1]) {
+	char cstring[string_size + 1];
+	memcpy(cstring, string, string_size);
+	cstring[string_size] = '\0';
+	return sscanf(cstring, "%f", value) == 1;
+}
+
+bool parse_double(size_t string_size, const char string[restrict static string_size], double value[restrict static 1]) {
+	char cstring[string_size + 1];
+	memcpy(cstring, string, string_size);
+	cstring[string_size] = '\0';
+	return sscanf(cstring, "%lf", value) == 1;
+}
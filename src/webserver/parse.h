@@ -3,13 +3,33 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#include <runner/cache.h>
+#include <runner/fence.h>
+
 enum webrunner_parameter {
 	webrunner_parameter_invalid = 0,
 	webrunner_parameter_kernel,
+	webrunner_parameter_events,
+	webrunner_parameter_profile,
+	webrunner_parameter_period,
+	webrunner_parameter_precision,
+	webrunner_parameter_budget_ms,
+	webrunner_parameter_samples,
+	webrunner_parameter_cache,
+	webrunner_parameter_warmup,
+	webrunner_parameter_max_drift,
+	webrunner_parameter_calls_per_sample,
+	webrunner_parameter_latency,
+	webrunner_parameter_fence,
+	webrunner_parameter_threads,
+	webrunner_parameter_sweep,
 	webrunner_parameter
 };
 
 enum webrunner_parameter parse_webrunner_parameter(size_t parameter_size, const char parameter[restrict static parameter_size]);
+enum cache_mode parse_cache_mode(size_t mode_size, const char mode[restrict static mode_size]);
+enum sweep_mode parse_sweep_mode(size_t mode_size, const char mode[restrict static mode_size]);
+enum fence_strategy parse_fence_strategy(size_t strategy_size, const char strategy[restrict static strategy_size]);
 
 struct end_of_line {
 	const char* start;
@@ -27,3 +47,7 @@ struct end_of_line find_end_of_line(size_t buffer_size, const char buffer[restri
 
 bool parse_uint32(size_t string_size, const char string[restrict static string_size], uint32_t value[restrict static 1]);
 bool parse_uint64(size_t string_size, const char string[restrict static string_size], uint64_t value[restrict static 1]);
+bool parse_int32(size_t string_size, const char string[restrict static string_size], int32_t value[restrict static 1]);
+bool parse_int64(size_t string_size, const char string[restrict static string_size], int64_t value[restrict static 1]);
+bool parse_float(size_t string_size, const char string[restrict static string_size], float value[restrict static 1]);
+bool parse_double(size_t string_size, const char string[restrict static string_size], double value[restrict static 1]);
@@ -5,9 +5,13 @@
 #include <ctype.h>
 #include <alloca.h>
 #include <limits.h>
+#include <inttypes.h>
+#include <time.h>
 
 #include <errno.h>
+#include <pthread.h>
 #include <sys/socket.h>
+#include <sys/mman.h>
 
 #include <webserver/http.h>
 #include <webserver/logs.h>
@@ -15,9 +19,34 @@
 #include <webrunner.h>
 #include <runner/spec.h>
 #include <runner/perfctr.h>
+#include <runner/sampling.h>
+#include <runner/timing.h>
+#include <runner/calibration.h>
+#include <runner/statistics.h>
+#include <runner/disturbance.h>
+#include <runner/cache.h>
+#include <runner/roofline.h>
+#include <runner/frequency.h>
+#include <runner/threads.h>
+#include <runner/arguments.h>
 
 #define MAX_HEADERS_SIZE 65536
 
+/* Maximum time budget for measurements (the sandbox limits CPU time of a request to 3 seconds) */
+#define MAX_BUDGET_MS 2000
+
+/* CPU time of a request after which measurements stop, below the limit of the sandbox */
+#define MAX_REQUEST_CPU_MS 2800
+
+/* Number of kernel calls in the sampling profiler mode */
+#define SAMPLING_ITERATIONS 1000
+
+/* Maximum number of kernel calls before measurements */
+#define MAX_WARMUP_ITERATIONS 10000
+
+/* Maximum number of times a performance counter group is measured again because the core frequency drifted */
+#define MAX_FREQUENCY_RETRIES 2
+
 struct webrunner_request {
 	enum http_method method;
 	enum http_content_type content_type;
@@ -120,7 +149,7 @@ static struct webrunner_request parse_target(size_t target_size, const char targ
 		log_fatal("invalid command: %.*s\n", (int) (command_end - command), command);
 	}
 
-	if (request.command != webrunner_command_monitor) {
+	if (request.command == webrunner_command_run) {
 		/* Pre-parse query parameters */
 		const char* query = command_end;
 		const struct http_parameter kernel_parameter = parse_http_parameter(target_end - query, query);
@@ -218,6 +247,828 @@ static struct webrunner_request parse_request_headers(
 	return request;
 }
 
+struct run_options {
+	const char* events;
+	size_t events_size;
+	enum webrunner_profile_mode profile_mode;
+	uint64_t sample_period;
+	/* Target relative precision of medians */
+	double precision;
+	/* Time budget for all measurements, in milliseconds */
+	uint64_t budget_ms;
+	/* Fixed number of samples per measurement, or 0 to sample until the medians converge */
+	uint64_t samples;
+	enum cache_mode cache_mode;
+	uint64_t warmup_iterations;
+	/* Maximum spread of the effective frequency relative to its median */
+	double max_drift;
+	/* Number of kernel calls per sample */
+	uint64_t calls_per_sample;
+	/* Chain kernel calls through their results */
+	bool latency;
+	/* Fences around the measured calls */
+	enum fence_strategy fence;
+	/* The fence was given in the query rather than selected by the startup calibration */
+	bool fence_requested;
+	/* Number of threads which call the kernel in parallel */
+	uint64_t threads;
+	/* Parameter sweep which replaces the single measurement */
+	enum sweep_mode sweep;
+};
+
+/*
+ * @brief Creates a sampling policy which gives a measurement an equal share of the remaining time budget.
+ * @param[in] options                Run options with the precision target.
+ * @param[in] deadline               End of the time budget for all measurements.
+ * @param[in] remaining_measurements Number of measurements which share the remaining time budget, including this one.
+ */
+static struct sampling_policy create_sampling_policy(const struct run_options options[restrict static 1],
+	uint64_t deadline, size_t remaining_measurements)
+{
+	const uint64_t now = get_monotonic_nanoseconds();
+	return (struct sampling_policy) {
+		.precision = options->samples != 0 ? 0.0 : options->precision,
+		.deadline = now < deadline ? now + (deadline - now) / remaining_measurements : now,
+		.max_samples = options->samples != 0 ? options->samples : MAX_SAMPLES,
+		.calls_per_sample = options->calls_per_sample,
+		.latency = options->latency,
+		.fence = options->fence,
+	};
+}
+
+/*
+ * @brief Returns the CPU time which the request process used so far, in nanoseconds.
+ */
+static uint64_t get_process_cpu_nanoseconds(void) {
+	struct timespec cpu_time;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu_time);
+	return (uint64_t) cpu_time.tv_sec * UINT64_C(1000000000) + (uint64_t) cpu_time.tv_nsec;
+}
+
+/*
+ * @brief Moves a deadline earlier if threads which run until it would exceed the CPU time limit of the sandbox.
+ * @details The limit counts the CPU time of all threads since the request process started, including the setup before
+ *          the sandbox was enabled.
+ * @param[in] now          Current time from get_monotonic_nanoseconds.
+ * @param[in] thread_count Number of threads which keep a processor busy until the deadline.
+ */
+static uint64_t limit_deadline_by_cpu_time(uint64_t now, uint64_t deadline, size_t thread_count) {
+	const uint64_t cpu_nanoseconds = get_process_cpu_nanoseconds();
+	const uint64_t cpu_limit = MAX_REQUEST_CPU_MS * UINT64_C(1000000);
+	const uint64_t cpu_deadline = now + (cpu_nanoseconds < cpu_limit ? (cpu_limit - cpu_nanoseconds) / thread_count : 0);
+	return deadline < cpu_deadline ? deadline : cpu_deadline;
+}
+
+/*
+ * @brief Creates the argument copies for the cache mode and the cache policy which describes them.
+ * @details Packs the buffers of all copies into one arena at a stride which is not a power of two, so that the copies
+ *          spread over all cache sets. Maps only anonymous memory, which the sandbox allows, but populating and filling
+ *          large buffers takes CPU time, so it is usually called before the sandbox is enabled.
+ * @param[in] memory Populated memory for the buffers of all copies, or NULL to map an arena for them.
+ * @return Array of cache->argument_copies argument structures.
+ */
+static void* create_argument_copies(enum webrunner_kernel kernel, const void* parameters,
+	const struct run_options options[restrict static 1], void* memory, struct cache_policy cache[restrict static 1])
+{
+	const struct kernel_specification* specification = &kernel_specifications[kernel];
+	const size_t region_count = specification->argument_region_count;
+	const size_t copy_footprint = align_cache_footprint(specification->get_working_set_size(parameters));
+	const size_t argument_copies = get_argument_copy_count(options->cache_mode, copy_footprint);
+	void* arguments = mmap(NULL, argument_copies * specification->arguments_size,
+		PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (arguments == MAP_FAILED) {
+		log_fatal("failed to allocate memory for arguments: %s\n", strerror(errno));
+	}
+	struct memory_region* regions = mmap(NULL, argument_copies * (region_count + 1) * sizeof(struct memory_region),
+		PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (regions == MAP_FAILED) {
+		log_fatal("failed to allocate memory for argument regions: %s\n", strerror(errno));
+	}
+
+	const size_t copy_arena_size = specification->get_arena_size(parameters);
+	const size_t copy_stride = get_argument_copy_stride(copy_arena_size, specification->arena_alignment);
+	const size_t arena_size = copy_arena_size != 0 && memory == NULL ? argument_copies * copy_stride : 0;
+	char* arena = memory != NULL ? memory : allocate_argument_arena(arena_size);
+	for (size_t copy = 0; copy < argument_copies; copy++) {
+		void* copy_arguments = (char*) arguments + copy * specification->arguments_size;
+		specification->create_arguments(copy_arguments, parameters, arena != NULL ? arena + copy * copy_stride : NULL);
+		specification->get_argument_regions(copy_arguments, parameters, &regions[copy * region_count]);
+	}
+
+	*cache = (struct cache_policy) {
+		.mode = options->cache_mode,
+		.warmup_iterations = options->warmup_iterations,
+		.argument_copies = argument_copies,
+		.arena = memory != NULL ? NULL : arena,
+		.arena_size = arena_size,
+		.copy_footprint = copy_footprint,
+		.regions = regions,
+		.region_count = region_count,
+		.clflushopt = is_clflushopt_supported(),
+	};
+	return arguments;
+}
+
+static void free_argument_copies(enum webrunner_kernel kernel, void* arguments, const void* parameters,
+	const struct cache_policy cache[restrict static 1])
+{
+	const struct kernel_specification* specification = &kernel_specifications[kernel];
+	for (size_t copy = 0; copy < cache->argument_copies; copy++) {
+		specification->free_arguments((char*) arguments + copy * specification->arguments_size, parameters);
+	}
+	free_argument_arena(cache->arena, cache->arena_size);
+	munmap(arguments, cache->argument_copies * specification->arguments_size);
+	munmap((void*) cache->regions, cache->argument_copies * (cache->region_count + 1) * sizeof(struct memory_region));
+}
+
+/*
+ * @brief Measures the reference implementation of a kernel with the timing backend and reports the speedup over it.
+ * @details Used when no performance counters are available; otherwise the reference is measured with every counter group.
+ * @param[in] tsc_ticks TSC ticks per call of the submitted kernel.
+ */
+static void run_reference(int connection_socket, enum webrunner_kernel kernel, const void* arguments,
+	const struct cache_policy cache[restrict static 1], const struct timing_backend timing_backend[restrict static 1],
+	const struct disturbance_counters disturbance_counters[restrict static 1], const struct sampling_policy policy[restrict static 1],
+	unsigned long long sample_buffer[restrict static timing_quantity_count * MAX_STORED_SAMPLES], unsigned long long tsc_ticks)
+{
+	const struct kernel_specification* specification = &kernel_specifications[kernel];
+	struct sample_accumulator accumulators[timing_quantity_count];
+	for (size_t i = 0; i < timing_quantity_count; i++) {
+		init_sample_accumulator(&accumulators[i], &sample_buffer[i * MAX_STORED_SAMPLES], MAX_STORED_SAMPLES);
+	}
+	struct timing_counts timing_overhead, timing_counts;
+	struct measurement_statistics timing_statistics;
+	if (get_timing_overhead(timing_backend, policy->fence, &timing_overhead) &&
+		specification->reference_time(specification->reference, arguments, cache, timing_backend, disturbance_counters, &timing_overhead,
+			policy, accumulators, &timing_counts, &timing_statistics))
+	{
+		report_reference_timing(connection_socket, specification->reference_name, &timing_counts, &timing_statistics, tsc_ticks);
+	}
+}
+
+/*
+ * @brief Writes the counts of the reference implementation and the speedup of the submitted kernel over it.
+ * @details The speedup compares core cycles if both implementations were measured in cycles, and TSC ticks otherwise.
+ */
+static void report_reference_counts(int connection_socket, enum webrunner_kernel kernel,
+	const struct performance_counters performance_counters[restrict static 1],
+	const unsigned long long counts[restrict static performance_counters->count],
+	const unsigned long long reference_counts[restrict static performance_counters->count],
+	const struct measurement_statistics reference_statistics[restrict static performance_counters->count],
+	unsigned long long tsc_ticks, unsigned long long reference_tsc_ticks,
+	const struct measurement_statistics reference_tsc_statistics[restrict static 1])
+{
+	dprintf(connection_socket, "Reference: %s\n", kernel_specifications[kernel].reference_name);
+	unsigned long long cycles = ULLONG_MAX, reference_cycles = ULLONG_MAX;
+	for (size_t i = 0; i < performance_counters->count; i++) {
+		if (reference_counts[i] != ULLONG_MAX) {
+			dprintf(connection_socket, "Reference %s: %llu (+/-%.1f%%, %zu samples)\n", performance_counters->counters[i].name,
+				reference_counts[i], 100.0 * reference_statistics[i].precision, reference_statistics[i].samples);
+			if (counts[i] != ULLONG_MAX && strcmp(performance_counters->counters[i].name, "Cycles") == 0) {
+				cycles = counts[i];
+				reference_cycles = reference_counts[i];
+			}
+		}
+	}
+	if (reference_tsc_ticks != ULLONG_MAX) {
+		dprintf(connection_socket, "Reference TSC ticks: %llu (+/-%.1f%%, %zu samples)\n", reference_tsc_ticks,
+			100.0 * reference_tsc_statistics->precision, reference_tsc_statistics->samples);
+	}
+	if (cycles != ULLONG_MAX && cycles != 0) {
+		dprintf(connection_socket, "Speedup over reference: %.3lf (Cycles)\n", (double) reference_cycles / (double) cycles);
+	} else if (reference_tsc_ticks != ULLONG_MAX && tsc_ticks != ULLONG_MAX && tsc_ticks != 0) {
+		dprintf(connection_socket, "Speedup over reference: %.3lf (TSC ticks)\n", (double) reference_tsc_ticks / (double) tsc_ticks);
+	}
+}
+
+static void run_counting(int connection_socket, enum webrunner_kernel kernel, generic_function function,
+	const void* parameters, const struct run_options options[restrict static 1])
+{
+	const struct performance_counters performance_counters = init_performance_counters(options->events_size, options->events);
+	/* Fallback for hosts without a usable hardware PMU, e.g. virtual machines */
+	const struct timing_backend timing_backend = init_timing_backend();
+	const struct disturbance_counters disturbance_counters = init_disturbance_counters();
+
+	/* Samples may not fit on the stack, and the sandbox forbids heap growth, so allocate them in advance */
+	unsigned long long* sample_buffer = allocate_sample_buffer(MAX_GROUP_COUNTERS + group_quantity_count);
+	if (sample_buffer == NULL) {
+		log_fatal("failed to allocate sample buffer: %s\n", strerror(errno));
+	}
+	struct sample_accumulator accumulators[MAX_GROUP_COUNTERS + group_quantity_count];
+
+	struct cache_policy cache;
+	void* arguments = create_argument_copies(kernel, parameters, options, NULL, &cache);
+	struct kernel_work work;
+	kernel_specifications[kernel].get_work(parameters, &work);
+
+	enable_sandbox(connection_socket);
+
+	http_respond_status(connection_socket, http_status_ok, "OK");
+
+	const uint64_t deadline = get_monotonic_nanoseconds() + options->budget_ms * UINT64_C(1000000);
+	const enum fence_strategy fence = options->fence;
+	/* The reference implementation is measured with every counter group, right after the submitted kernel */
+	const generic_function reference = kernel_specifications[kernel].reference;
+	const size_t measurements_per_group = reference != NULL ? 2 : 1;
+	unsigned long long counts[performance_counters.count], reference_counts[performance_counters.count];
+	struct measurement_statistics statistics[performance_counters.count], reference_statistics[performance_counters.count];
+	for (size_t i = 0; i < performance_counters.count; i++) {
+		counts[i] = ULLONG_MAX;
+		reference_counts[i] = ULLONG_MAX;
+	}
+	unsigned long long reference_tsc_ticks = ULLONG_MAX;
+	struct measurement_statistics reference_tsc_statistics;
+	size_t accepted_samples = 0, rejected_samples = 0;
+	/* Nominal timing and frequency come from the first group which counts core cycles, or else from the first group */
+	unsigned long long tsc_ticks = ULLONG_MAX;
+	struct measurement_statistics tsc_statistics;
+	struct frequency_statistics frequency = { 0 };
+	size_t frequency_retries = 0;
+	for (size_t group_index = 0; group_index < performance_counters.group_count; group_index++) {
+		const struct performance_counter_group* group = &performance_counters.groups[group_index];
+		unsigned long long group_overhead[MAX_GROUP_COUNTERS + 1], group_counts[MAX_GROUP_COUNTERS];
+		struct measurement_statistics group_statistics[MAX_GROUP_COUNTERS];
+		struct frequency_statistics group_frequency = { 0 };
+		bool success = false;
+		size_t retries = 0;
+		ioctl(group->file_descriptor, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+		if (get_performance_counter_group_overhead(&performance_counters, group, fence, group_overhead)) {
+			/* Measure the group again if the core frequency drifted, e.g. because of thermal or power throttling */
+			for (;; retries++) {
+				const struct sampling_policy policy =
+					create_sampling_policy(options, deadline, (performance_counters.group_count - group_index) * measurements_per_group);
+				for (size_t i = 0; i < group->count + group_quantity_count; i++) {
+					init_sample_accumulator(&accumulators[i], &sample_buffer[i * MAX_STORED_SAMPLES], MAX_STORED_SAMPLES);
+				}
+				success = kernel_specifications[kernel].profile(function, arguments, &cache, group, &disturbance_counters,
+					group_overhead, &policy, accumulators, group_counts, group_statistics);
+				if (!success || !summarize_frequency(&accumulators[group->count + group_quantity_frequency_ratio], &group_frequency) ||
+					group_frequency.drift <= options->max_drift || retries == MAX_FREQUENCY_RETRIES ||
+					get_monotonic_nanoseconds() >= deadline)
+				{
+					break;
+				}
+			}
+		}
+		/* Nominal timing of the kernel and of its reference come from the same group */
+		bool nominal_group = false;
+		if (success) {
+			for (size_t i = 0; i < group->count; i++) {
+				counts[group->counter_index[i]] = group_counts[i];
+				statistics[group->counter_index[i]] = group_statistics[i];
+			}
+			accepted_samples += group_statistics[0].samples;
+			rejected_samples += group_statistics[0].rejected_samples;
+			if (tsc_ticks == ULLONG_MAX || (frequency.samples == 0 && group_frequency.samples != 0)) {
+				nominal_group = true;
+				tsc_ticks = summarize_samples(&accumulators[group->count + group_quantity_tsc_ticks],
+					group_overhead[group->count], options->calls_per_sample, &tsc_statistics);
+				tsc_statistics.rejected_samples = group_statistics[0].rejected_samples;
+				frequency = group_frequency;
+				frequency_retries = retries;
+			}
+		}
+		if (success && reference != NULL) {
+			const struct sampling_policy policy =
+				create_sampling_policy(options, deadline, (performance_counters.group_count - group_index) * measurements_per_group - 1);
+			for (size_t i = 0; i < group->count + group_quantity_count; i++) {
+				init_sample_accumulator(&accumulators[i], &sample_buffer[i * MAX_STORED_SAMPLES], MAX_STORED_SAMPLES);
+			}
+			if (kernel_specifications[kernel].reference_profile(reference, arguments, &cache, group, &disturbance_counters,
+				group_overhead, &policy, accumulators, group_counts, group_statistics))
+			{
+				for (size_t i = 0; i < group->count; i++) {
+					reference_counts[group->counter_index[i]] = group_counts[i];
+					reference_statistics[group->counter_index[i]] = group_statistics[i];
+				}
+				/* Until the reference is measured with the kernel's nominal group, keep the first group as a fallback */
+				if (nominal_group || reference_tsc_ticks == ULLONG_MAX) {
+					reference_tsc_ticks = summarize_samples(&accumulators[group->count + group_quantity_tsc_ticks],
+						group_overhead[group->count], options->calls_per_sample, &reference_tsc_statistics);
+				}
+			}
+		}
+		ioctl(group->file_descriptor, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+	}
+	bool measured = false;
+	for (size_t i = 0; i < performance_counters.count; i++) {
+		measured |= counts[i] != ULLONG_MAX;
+	}
+	if (measured) {
+		dprintf(connection_socket, "Backend: performance counters\n");
+		report_fence_strategy(connection_socket, fence, !options->fence_requested);
+		for (size_t i = 0; i < performance_counters.count; i++) {
+			if (counts[i] != ULLONG_MAX) {
+				dprintf(connection_socket, "%s: %llu (+/-%.1f%%, %zu samples)\n", performance_counters.counters[i].name, counts[i],
+					100.0 * statistics[i].precision, statistics[i].samples);
+				report_tail_quantiles(connection_socket, performance_counters.counters[i].name, &statistics[i]);
+			}
+		}
+		report_nominal_timing(connection_socket, tsc_ticks, &tsc_statistics, timing_backend.tsc_frequency);
+		if (frequency.samples != 0) {
+			report_frequency(connection_socket, &frequency, timing_backend.tsc_frequency, options->max_drift, frequency_retries);
+		}
+		report_cache_policy(connection_socket, &cache);
+		report_rejected_samples(connection_socket, &disturbance_counters, rejected_samples, accepted_samples);
+		/* Per-cycle metrics use core cycles if they were counted; time and the roofline always use TSC ticks */
+		unsigned long long cycles = tsc_ticks;
+		const char* cycles_name = "TSC ticks";
+		for (size_t i = 0; i < performance_counters.count; i++) {
+			if (counts[i] != ULLONG_MAX && strcmp(performance_counters.counters[i].name, "Cycles") == 0) {
+				cycles = counts[i];
+				cycles_name = "Cycles";
+			}
+		}
+		if (cycles != ULLONG_MAX) {
+			report_roofline(connection_socket, &work, cycles, cycles_name, tsc_ticks, timing_backend.tsc_frequency,
+				kernel_specifications[kernel].get_working_set_size(parameters), options->cache_mode);
+		}
+		if (reference != NULL) {
+			report_reference_counts(connection_socket, kernel, &performance_counters, counts, reference_counts, reference_statistics,
+				tsc_ticks, reference_tsc_ticks, &reference_tsc_statistics);
+		}
+	} else {
+		const struct sampling_policy policy = create_sampling_policy(options, deadline, reference != NULL ? 2 : 1);
+		struct timing_counts timing_overhead, timing_counts;
+		struct measurement_statistics timing_statistics;
+		for (size_t i = 0; i < timing_quantity_count; i++) {
+			init_sample_accumulator(&accumulators[i], &sample_buffer[i * MAX_STORED_SAMPLES], MAX_STORED_SAMPLES);
+		}
+		if (get_timing_overhead(&timing_backend, fence, &timing_overhead) &&
+			kernel_specifications[kernel].time(function, arguments, &cache, &timing_backend, &disturbance_counters, &timing_overhead, &policy,
+				accumulators, &timing_counts, &timing_statistics))
+		{
+			report_timing_counts(connection_socket, &timing_backend, &timing_counts, &timing_statistics);
+			report_fence_strategy(connection_socket, fence, !options->fence_requested);
+			report_cache_policy(connection_socket, &cache);
+			report_rejected_samples(connection_socket, &disturbance_counters,
+				timing_statistics.rejected_samples, timing_statistics.samples);
+			report_roofline(connection_socket, &work, timing_counts.tsc_ticks, "TSC ticks", timing_counts.tsc_ticks,
+				timing_backend.tsc_frequency, kernel_specifications[kernel].get_working_set_size(parameters), options->cache_mode);
+			if (reference != NULL) {
+				const struct sampling_policy reference_policy = create_sampling_policy(options, deadline, 1);
+				run_reference(connection_socket, kernel, arguments, &cache, &timing_backend, &disturbance_counters, &reference_policy,
+					sample_buffer, timing_counts.tsc_ticks);
+			}
+		}
+	}
+	struct tma_metrics tma_metrics;
+	if (compute_tma_metrics(&performance_counters, counts, &tma_metrics)) {
+		report_tma_metrics(connection_socket, &tma_metrics);
+	}
+
+	free_argument_copies(kernel, arguments, parameters, &cache);
+}
+
+/* State of one thread in a parallel run */
+struct parallel_thread {
+	pthread_t thread;
+	/* Logical processor the thread is pinned to */
+	int cpu;
+	struct parallel_run* run;
+	/* Counters, clocks, and arguments of the thread, opened and allocated by the thread itself */
+	struct performance_counters performance_counters;
+	struct timing_backend timing_backend;
+	struct disturbance_counters disturbance_counters;
+	unsigned long long* sample_buffer;
+	struct cache_policy cache;
+	void* arguments;
+	/* Counts of the members of the first counter group, or ULLONG_MAX if the thread was measured with the timing backend */
+	unsigned long long counts[MAX_GROUP_COUNTERS];
+	struct measurement_statistics statistics[MAX_GROUP_COUNTERS];
+	/* TSC ticks per kernel call, or ULLONG_MAX if the measurement failed */
+	unsigned long long tsc_ticks;
+	struct measurement_statistics tsc_statistics;
+};
+
+struct parallel_run {
+	enum webrunner_kernel kernel;
+	generic_function function;
+	const void* parameters;
+	const struct run_options* options;
+	/* Separates the setup, the measurement, and the report phases */
+	struct spin_barrier barrier;
+	/* End of the measurements, set by the first thread after the sandbox is enabled */
+	uint64_t deadline;
+	size_t thread_count;
+	struct parallel_thread threads[MAX_THREADS];
+};
+
+/*
+ * @brief Pins the calling thread, opens its counters, and creates its own copy of the kernel arguments.
+ * @details Runs on the measured thread, so that per-thread counters follow it and argument pages are local to it.
+ */
+static void prepare_parallel_thread(struct parallel_thread thread[restrict static 1]) {
+	const struct parallel_run* run = thread->run;
+	pin_thread(thread->cpu);
+	thread->performance_counters = init_performance_counters(run->options->events_size, run->options->events);
+	thread->timing_backend = init_timing_backend();
+	thread->disturbance_counters = init_disturbance_counters();
+	thread->sample_buffer = allocate_sample_buffer(MAX_GROUP_COUNTERS + group_quantity_count);
+	if (thread->sample_buffer == NULL) {
+		log_fatal("failed to allocate sample buffer: %s\n", strerror(errno));
+	}
+	thread->arguments = create_argument_copies(run->kernel, run->parameters, run->options, NULL, &thread->cache);
+}
+
+/*
+ * @brief Measures the kernel on the calling thread until the common deadline.
+ * @details All threads sample until the same deadline regardless of the precision target, so that the kernel runs on
+ *          all processors for the whole measurement. Only the first counter group is measured.
+ */
+static void measure_parallel_thread(struct parallel_thread thread[restrict static 1]) {
+	const struct parallel_run* run = thread->run;
+	const struct run_options* options = run->options;
+	const struct kernel_specification* specification = &kernel_specifications[run->kernel];
+	const struct sampling_policy policy = {
+		.precision = 0.0,
+		.deadline = run->deadline,
+		.max_samples = options->samples != 0 ? options->samples : MAX_SAMPLES,
+		.calls_per_sample = options->calls_per_sample,
+		.latency = options->latency,
+		.fence = options->fence,
+	};
+	for (size_t i = 0; i < MAX_GROUP_COUNTERS; i++) {
+		thread->counts[i] = ULLONG_MAX;
+	}
+	thread->tsc_ticks = ULLONG_MAX;
+	struct sample_accumulator accumulators[MAX_GROUP_COUNTERS + group_quantity_count];
+	const struct performance_counters* performance_counters = &thread->performance_counters;
+	if (performance_counters->group_count != 0 && performance_counters->groups[0].file_descriptor != -1) {
+		const struct performance_counter_group* group = &performance_counters->groups[0];
+		unsigned long long group_overhead[MAX_GROUP_COUNTERS + 1];
+		for (size_t i = 0; i < group->count + group_quantity_count; i++) {
+			init_sample_accumulator(&accumulators[i], &thread->sample_buffer[i * MAX_STORED_SAMPLES], MAX_STORED_SAMPLES);
+		}
+		ioctl(group->file_descriptor, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+		if (get_performance_counter_group_overhead(performance_counters, group, options->fence, group_overhead) &&
+			specification->profile(run->function, thread->arguments, &thread->cache, group, &thread->disturbance_counters,
+				group_overhead, &policy, accumulators, thread->counts, thread->statistics))
+		{
+			thread->tsc_ticks = summarize_samples(&accumulators[group->count + group_quantity_tsc_ticks],
+				group_overhead[group->count], options->calls_per_sample, &thread->tsc_statistics);
+		}
+		ioctl(group->file_descriptor, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+	} else {
+		struct timing_counts timing_overhead, timing_counts;
+		for (size_t i = 0; i < timing_quantity_count; i++) {
+			init_sample_accumulator(&accumulators[i], &thread->sample_buffer[i * MAX_STORED_SAMPLES], MAX_STORED_SAMPLES);
+		}
+		if (get_timing_overhead(&thread->timing_backend, options->fence, &timing_overhead) &&
+			specification->time(run->function, thread->arguments, &thread->cache, &thread->timing_backend,
+				&thread->disturbance_counters, &timing_overhead, &policy, accumulators, &timing_counts, &thread->tsc_statistics))
+		{
+			thread->tsc_ticks = timing_counts.tsc_ticks;
+		}
+	}
+}
+
+/*
+ * @brief Entry point of the threads which the first thread of a parallel run starts.
+ * @details The threads never return: they wait for the process to exit after the measurements.
+ */
+static void* run_parallel_worker(void* context) {
+	struct parallel_thread* thread = (struct parallel_thread*) context;
+	struct parallel_run* run = thread->run;
+	prepare_parallel_thread(thread);
+	/* All threads are set up; the first thread enables the sandbox and sets the deadline. Threads which finished their
+	 * setup early sleep rather than spin, because the CPU time limit of the sandbox counts every thread. */
+	wait_spin_barrier(&run->barrier, true);
+	/* All threads start measuring together */
+	wait_spin_barrier(&run->barrier, false);
+	measure_parallel_thread(thread);
+	wait_spin_barrier(&run->barrier, true);
+	park_thread();
+}
+
+/*
+ * @brief Calls the kernel on several pinned threads at the same time and reports per-thread and aggregate results.
+ * @details Every thread measures its own arguments with its own counters. The threads are started before the sandbox
+ *          is enabled, because the sandbox forbids clone, perf_event_open, and sched_setaffinity.
+ */
+static void run_parallel(int connection_socket, enum webrunner_kernel kernel, generic_function function,
+	const void* parameters, const struct run_options options[restrict static 1])
+{
+	struct run_options parallel_options = *options;
+	if (parallel_options.events == NULL) {
+		/* Every thread opens its own counters, and only the first group is measured */
+		parallel_options.events = "basic";
+		parallel_options.events_size = strlen(parallel_options.events);
+	}
+	/* The CPU time limit of the sandbox applies to all threads together */
+	if (parallel_options.budget_ms > MAX_BUDGET_MS / parallel_options.threads) {
+		parallel_options.budget_ms = MAX_BUDGET_MS / parallel_options.threads;
+	}
+
+	int cpus[MAX_THREADS];
+	const size_t thread_count = (size_t) parallel_options.threads;
+	const size_t cpu_count = get_core_cpus(thread_count, cpus);
+	if (cpu_count < thread_count) {
+		log_fatal("%zu threads requested, but only %zu physical cores are available\n", thread_count, cpu_count);
+	}
+
+	/* Too large for the stack of the request process, and shared with the other threads */
+	struct parallel_run* run = mmap(NULL, sizeof(struct parallel_run),
+		PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (run == MAP_FAILED) {
+		log_fatal("failed to allocate memory for threads: %s\n", strerror(errno));
+	}
+	run->kernel = kernel;
+	run->function = function;
+	run->parameters = parameters;
+	run->options = &parallel_options;
+	run->thread_count = thread_count;
+	init_spin_barrier(&run->barrier, thread_count);
+	for (size_t i = 0; i < thread_count; i++) {
+		run->threads[i].cpu = cpus[i];
+		run->threads[i].run = run;
+	}
+	for (size_t i = 1; i < thread_count; i++) {
+		const int error = pthread_create(&run->threads[i].thread, NULL, run_parallel_worker, &run->threads[i]);
+		if (error != 0) {
+			log_fatal("failed to create thread: %s\n", strerror(error));
+		}
+	}
+	struct parallel_thread* first_thread = &run->threads[0];
+	prepare_parallel_thread(first_thread);
+	wait_spin_barrier(&run->barrier, true);
+	/* Filling the arguments of many threads may use up the CPU time limit before the sandbox even starts counting */
+	if (get_process_cpu_nanoseconds() >= MAX_REQUEST_CPU_MS * UINT64_C(1000000)) {
+		log_fatal("setting up %zu threads used more CPU time than the sandbox allows\n", thread_count);
+	}
+
+	enable_sandbox(connection_socket);
+
+	http_respond_status(connection_socket, http_status_ok, "OK");
+
+	const uint64_t now = get_monotonic_nanoseconds();
+	run->deadline = limit_deadline_by_cpu_time(now, now + parallel_options.budget_ms * UINT64_C(1000000), thread_count);
+	wait_spin_barrier(&run->barrier, false);
+	measure_parallel_thread(first_thread);
+	wait_spin_barrier(&run->barrier, true);
+
+	dprintf(connection_socket, "Threads: %zu\n", thread_count);
+	report_fence_strategy(connection_socket, parallel_options.fence, !parallel_options.fence_requested);
+	report_cache_policy(connection_socket, &first_thread->cache);
+	unsigned long long tsc_ticks[thread_count];
+	for (size_t t = 0; t < thread_count; t++) {
+		const struct parallel_thread* thread = &run->threads[t];
+		tsc_ticks[t] = thread->tsc_ticks;
+		if (thread->tsc_ticks == ULLONG_MAX) {
+			dprintf(connection_socket, "Thread %zu (CPU %d): not measured\n", t, thread->cpu);
+			continue;
+		}
+		if (thread->counts[0] != ULLONG_MAX) {
+			const struct performance_counter_group* group = &thread->performance_counters.groups[0];
+			for (size_t i = 0; i < group->count; i++) {
+				dprintf(connection_socket, "Thread %zu (CPU %d) %s: %llu (+/-%.1f%%, %zu samples)\n", t, thread->cpu,
+					thread->performance_counters.counters[group->counter_index[i]].name, thread->counts[i],
+					100.0 * thread->statistics[i].precision, thread->statistics[i].samples);
+			}
+		}
+		dprintf(connection_socket, "Thread %zu (CPU %d) TSC ticks: %llu (+/-%.1f%%, %zu samples)\n", t, thread->cpu,
+			thread->tsc_ticks, 100.0 * thread->tsc_statistics.precision, thread->tsc_statistics.samples);
+	}
+	struct kernel_work work;
+	kernel_specifications[kernel].get_work(parameters, &work);
+	report_parallel_throughput(connection_socket, &work, thread_count, tsc_ticks, first_thread->timing_backend.tsc_frequency);
+}
+
+/*
+ * @brief Sets the sweep parameter of a kernel to the largest value whose working set fits into the specified size.
+ * @details Assumes that the working set grows with the parameter. If even the smallest value does not fit, uses it.
+ * @param[out] fitted_working_set Working set of the kernel call with the chosen parameter, in bytes.
+ * @return The chosen value of the parameter.
+ */
+static uint64_t fit_sweep_parameter(const struct kernel_specification specification[restrict static 1], void* parameters,
+	uint64_t working_set, uint64_t fitted_working_set[restrict static 1])
+{
+	/* Find a value whose working set exceeds the target by doubling, then bisect between it and its half */
+	uint64_t low = 1, high = 1;
+	for (;;) {
+		specification->set_sweep_parameter(parameters, high);
+		if (specification->get_working_set_size(parameters) > working_set || high >= (UINT64_C(1) << 40)) {
+			break;
+		}
+		low = high;
+		high *= 2;
+	}
+	while (high - low > 1) {
+		const uint64_t middle = low + (high - low) / 2;
+		specification->set_sweep_parameter(parameters, middle);
+		if (specification->get_working_set_size(parameters) <= working_set) {
+			low = middle;
+		} else {
+			high = middle;
+		}
+	}
+	specification->set_sweep_parameter(parameters, low);
+	*fitted_working_set = specification->get_working_set_size(parameters);
+	return low;
+}
+
+/*
+ * @brief Returns the name of the closest cache level which holds the working set, or "memory" if none does.
+ */
+static const char* get_working_set_level(const struct x86_cache_info cache_info[restrict static 1], uint64_t working_set,
+	char name[restrict static 4])
+{
+	for (size_t i = 0; i < cache_info->count; i++) {
+		if (working_set <= cache_info->levels[i].size) {
+			snprintf(name, 4, "L%"PRIu32, cache_info->levels[i].level);
+			return name;
+		}
+	}
+	return "memory";
+}
+
+/*
+ * @brief Measures the kernel at working-set sizes around each cache level and reports cycles per element and bandwidth.
+ * @details The sweep parameter of the kernel specification is fitted to each working-set size. One arena for the largest
+ *          point is populated before the sandbox is enabled; the arguments of each point are laid out at its start right
+ *          before the point is measured, so that the request needs memory for one point. The time to fill the buffers
+ *          does not count against the time budget. Only the first counter group is measured, and its core cycles are
+ *          reported if it counts them.
+ */
+static void run_cache_sweep(int connection_socket, enum webrunner_kernel kernel, generic_function function,
+	const void* parameters, const struct run_options options[restrict static 1])
+{
+	const struct kernel_specification* specification = &kernel_specifications[kernel];
+	if (specification->set_sweep_parameter == NULL) {
+		log_fatal("kernel %s does not declare a sweep parameter\n", specification->name);
+	}
+	if (options->cache_mode != cache_mode_warm) {
+		log_fatal("the cache sweep requires the warm cache mode\n");
+	}
+	size_t working_set_targets[MAX_SWEEP_POINTS];
+	const size_t target_count = get_cache_sweep_sizes(working_set_targets);
+	if (target_count == 0) {
+		log_fatal("the cache sweep requires cache sizes from CPUID\n");
+	}
+	/* Fit the sweep parameter to every size, and drop sizes which give the same working set as the previous one */
+	char* point_parameters = alloca(target_count * specification->parameters_size);
+	uint64_t working_sets[MAX_SWEEP_POINTS], sweep_values[MAX_SWEEP_POINTS];
+	size_t point_count = 0;
+	for (size_t i = 0; i < target_count; i++) {
+		void* point = point_parameters + point_count * specification->parameters_size;
+		memcpy(point, parameters, specification->parameters_size);
+		sweep_values[point_count] = fit_sweep_parameter(specification, point, working_set_targets[i], &working_sets[point_count]);
+		if (point_count == 0 || working_sets[point_count] != working_sets[point_count - 1]) {
+			point_count += 1;
+		}
+	}
+
+	/* Core cycles per element are the point of the sweep, so do not measure other events by default */
+	const struct performance_counters performance_counters = options->events != NULL ?
+		init_performance_counters(options->events_size, options->events) :
+		init_performance_counters(strlen("Cycles"), "Cycles");
+	const struct timing_backend timing_backend = init_timing_backend();
+	const struct disturbance_counters disturbance_counters = init_disturbance_counters();
+	unsigned long long* sample_buffer = allocate_sample_buffer(MAX_GROUP_COUNTERS + group_quantity_count);
+	if (sample_buffer == NULL) {
+		log_fatal("failed to allocate sample buffer: %s\n", strerror(errno));
+	}
+	struct sample_accumulator accumulators[MAX_GROUP_COUNTERS + group_quantity_count];
+	const struct performance_counter_group* group = performance_counters.group_count != 0 &&
+		performance_counters.groups[0].file_descriptor != -1 ? &performance_counters.groups[0] : NULL;
+	/* The sandbox forbids populating memory, so map the buffers of the largest point now and reuse them for all points */
+	size_t arena_size = 0;
+	for (size_t point = 0; point < point_count; point++) {
+		const size_t point_arena_size = specification->get_arena_size(point_parameters + point * specification->parameters_size);
+		arena_size = point_arena_size > arena_size ? point_arena_size : arena_size;
+	}
+	void* arena = allocate_argument_arena(arena_size);
+
+	enable_sandbox(connection_socket);
+
+	http_respond_status(connection_socket, http_status_ok, "OK");
+
+	uint64_t deadline = get_monotonic_nanoseconds() + options->budget_ms * UINT64_C(1000000);
+	const char* cycles_name = group != NULL && group->cycles_index != SIZE_MAX ? "Cycles" : "TSC ticks";
+	unsigned long long group_overhead[MAX_GROUP_COUNTERS + 1];
+	struct timing_counts timing_overhead;
+	if (group != NULL) {
+		ioctl(group->file_descriptor, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+		if (!get_performance_counter_group_overhead(&performance_counters, group, options->fence, group_overhead)) {
+			log_fatal("failed to measure the overhead of performance counters\n");
+		}
+	} else if (!get_timing_overhead(&timing_backend, options->fence, &timing_overhead)) {
+		log_fatal("failed to measure the overhead of the timing backend\n");
+	}
+	dprintf(connection_socket, "Sweep: cache (parameter %s, %zu points)\n", specification->sweep_parameter_name, point_count);
+	dprintf(connection_socket, "Backend: %s\n", group != NULL ? "performance counters" : "timing");
+	report_fence_strategy(connection_socket, options->fence, !options->fence_requested);
+	report_cache_hierarchy(connection_socket);
+
+	const struct x86_cache_info* cache_info = get_cache_info();
+	size_t boundary = 0;
+	for (size_t point = 0; point < point_count; point++) {
+		const void* point_parameters_ptr = point_parameters + point * specification->parameters_size;
+		/* Mark the cache levels which the working set outgrew since the previous point */
+		for (; boundary < cache_info->count && cache_info->levels[boundary].size < working_sets[point]; boundary++) {
+			if (point != 0) {
+				dprintf(connection_socket, "Boundary: L%"PRIu32" (%zu KiB)\n",
+					cache_info->levels[boundary].level, cache_info->levels[boundary].size / 1024);
+			}
+		}
+
+		/* Filling the buffers of large points takes a while, and must not eat into the measurement budget */
+		const uint64_t setup_start = get_monotonic_nanoseconds();
+		struct cache_policy cache;
+		void* arguments = create_argument_copies(kernel, point_parameters_ptr, options, arena, &cache);
+		const uint64_t setup_end = get_monotonic_nanoseconds();
+		/* The setup still counts against the CPU time limit of the sandbox, which would kill the request */
+		deadline = limit_deadline_by_cpu_time(setup_end, deadline + (setup_end - setup_start), 1);
+		struct kernel_work work;
+		specification->get_work(point_parameters_ptr, &work);
+		const struct sampling_policy policy = create_sampling_policy(options, deadline, point_count - point);
+		unsigned long long cycles = ULLONG_MAX, tsc_ticks = ULLONG_MAX;
+		struct measurement_statistics statistics;
+		if (group != NULL) {
+			unsigned long long group_counts[MAX_GROUP_COUNTERS];
+			struct measurement_statistics group_statistics[MAX_GROUP_COUNTERS];
+			for (size_t i = 0; i < group->count + group_quantity_count; i++) {
+				init_sample_accumulator(&accumulators[i], &sample_buffer[i * MAX_STORED_SAMPLES], MAX_STORED_SAMPLES);
+			}
+			if (specification->profile(function, arguments, &cache, group, &disturbance_counters,
+				group_overhead, &policy, accumulators, group_counts, group_statistics))
+			{
+				tsc_ticks = summarize_samples(&accumulators[group->count + group_quantity_tsc_ticks],
+					group_overhead[group->count], options->calls_per_sample, &statistics);
+				if (group->cycles_index != SIZE_MAX) {
+					cycles = group_counts[group->cycles_index];
+					statistics = group_statistics[group->cycles_index];
+				} else {
+					cycles = tsc_ticks;
+				}
+			}
+		} else {
+			struct timing_counts timing_counts;
+			for (size_t i = 0; i < timing_quantity_count; i++) {
+				init_sample_accumulator(&accumulators[i], &sample_buffer[i * MAX_STORED_SAMPLES], MAX_STORED_SAMPLES);
+			}
+			if (specification->time(function, arguments, &cache, &timing_backend, &disturbance_counters, &timing_overhead,
+				&policy, accumulators, &timing_counts, &statistics))
+			{
+				cycles = tsc_ticks = timing_counts.tsc_ticks;
+			}
+		}
+		free_argument_copies(kernel, arguments, point_parameters_ptr, &cache);
+
+		char level_name[4];
+		dprintf(connection_socket, "Working set %"PRIu64" KiB (%s, %s=%"PRIu64"): ",
+			working_sets[point] / 1024, get_working_set_level(cache_info, working_sets[point], level_name),
+			specification->sweep_parameter_name, sweep_values[point]);
+		if (cycles == ULLONG_MAX) {
+			dprintf(connection_socket, "not measured\n");
+			continue;
+		}
+		if (work.elements != 0) {
+			dprintf(connection_socket, "%.3lf %s per element", (double) cycles / (double) work.elements, cycles_name);
+		} else {
+			dprintf(connection_socket, "%llu %s per call", cycles, cycles_name);
+		}
+		if (work.bytes != 0 && timing_backend.tsc_frequency != 0 && tsc_ticks != 0) {
+			dprintf(connection_socket, ", %.3lf GB/s",
+				(double) work.bytes * (double) timing_backend.tsc_frequency / (double) tsc_ticks * 1.0e-9);
+		}
+		dprintf(connection_socket, " (+/-%.1f%%, %zu samples)\n", 100.0 * statistics.precision, statistics.samples);
+	}
+	if (group != NULL) {
+		ioctl(group->file_descriptor, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+	}
+	free_argument_arena(arena, arena_size);
+}
+
+static void run_sampling(int connection_socket, enum webrunner_kernel kernel, generic_function function, size_t code_size,
+	const void* parameters, const struct run_options options[restrict static 1])
+{
+	const struct sampling_counters sampling_counters =
+		init_sampling_counters(options->events_size, options->events, options->sample_period);
+	struct sample_histogram histograms[sampling_counters.count];
+	for (size_t i = 0; i < sampling_counters.count; i++) {
+		histograms[i] = init_sample_histogram(function, code_size);
+	}
+
+	void* arguments = alloca(kernel_specifications[kernel].arguments_size);
+	kernel_specifications[kernel].create_arguments(arguments, parameters, NULL);
+
+	enable_sandbox(connection_socket);
+
+	http_respond_status(connection_socket, http_status_ok, "OK");
+
+	for (size_t i = 0; i < sampling_counters.count; i++) {
+		const struct sampling_counter* counter = &sampling_counters.counters[i];
+		ioctl(counter->file_descriptor, PERF_EVENT_IOC_ENABLE, 0);
+		kernel_specifications[kernel].sample(function, arguments, counter, SAMPLING_ITERATIONS, &histograms[i]);
+		ioctl(counter->file_descriptor, PERF_EVENT_IOC_DISABLE, 0);
+		drain_sampling_counter(counter, &histograms[i]);
+		report_sample_histogram(connection_socket, counter->name, &histograms[i]);
+	}
+
+	kernel_specifications[kernel].free_arguments(arguments, parameters);
+}
+
 void process_request(int connection_socket) {
 	char request_buffer[MAX_HEADERS_SIZE];
 	int bytes_received = recv(connection_socket, request_buffer, MAX_HEADERS_SIZE, 0);
@@ -243,11 +1094,29 @@ void process_request(int connection_socket) {
 
 	if (request.command == webrunner_command_monitor) {
 		http_respond_status(connection_socket, http_status_ok, "OK");
+	} else if (request.command == webrunner_command_calibration) {
+		http_respond_status(connection_socket, http_status_ok, "OK");
+		if (request.method != http_method_head) {
+			report_measurement_overhead(connection_socket);
+		}
 	} else {
 		const enum webrunner_kernel kernel = request.kernel;
 
 		void* parameters = alloca(kernel_specifications[kernel].parameters_size);
 		memcpy(parameters, kernel_specifications[kernel].parameters_default, kernel_specifications[kernel].parameters_size);
+		struct run_options options = {
+			.profile_mode = webrunner_profile_mode_count,
+			.sample_period = 10000,
+			.precision = 0.01,
+			.budget_ms = 1000,
+			.cache_mode = cache_mode_warm,
+			.warmup_iterations = 1,
+			.max_drift = DEFAULT_MAX_FREQUENCY_DRIFT,
+			.calls_per_sample = 1,
+			.fence = get_default_fence_strategy(),
+			.threads = 1,
+			.sweep = sweep_mode_none,
+		};
 		if (request.kernel_parameters_query_size != 0) {
 			const char* query = request.kernel_parameters_query;
 			const char *const query_end = &query[request.kernel_parameters_query_size];
@@ -260,8 +1129,110 @@ void process_request(int connection_socket) {
 					log_error("parameter %.*s specified without value\n",
 						(int) parameter.name_size, parameter.name);
 				} else {
-					kernel_specifications[kernel].parse_parameter(parameters,
-						parameter.name_size, parameter.name, parameter.value_size, parameter.value);
+					switch (parse_webrunner_parameter(parameter.name_size, parameter.name)) {
+						case webrunner_parameter_events:
+							options.events = parameter.value;
+							options.events_size = parameter.value_size;
+							break;
+						case webrunner_parameter_profile:
+							options.profile_mode = parse_webrunner_profile_mode(parameter.value_size, parameter.value);
+							if (options.profile_mode == webrunner_profile_mode_invalid) {
+								log_fatal("invalid profile mode %.*s\n", (int) parameter.value_size, parameter.value);
+							}
+							break;
+						case webrunner_parameter_period:
+							if (!parse_uint64(parameter.value_size, parameter.value, &options.sample_period) || options.sample_period == 0) {
+								log_fatal("invalid sampling period %.*s\n", (int) parameter.value_size, parameter.value);
+							}
+							break;
+						case webrunner_parameter_precision:
+							if (!parse_double(parameter.value_size, parameter.value, &options.precision) ||
+								!(options.precision >= 0.0 && options.precision < 1.0))
+							{
+								log_fatal("invalid precision %.*s\n", (int) parameter.value_size, parameter.value);
+							}
+							break;
+						case webrunner_parameter_budget_ms:
+							if (!parse_uint64(parameter.value_size, parameter.value, &options.budget_ms) ||
+								options.budget_ms == 0 || options.budget_ms > MAX_BUDGET_MS)
+							{
+								log_fatal("invalid time budget %.*s\n", (int) parameter.value_size, parameter.value);
+							}
+							break;
+						case webrunner_parameter_samples:
+							if (!parse_uint64(parameter.value_size, parameter.value, &options.samples) ||
+								options.samples == 0 || options.samples > MAX_SAMPLES)
+							{
+								log_fatal("invalid sample count %.*s\n", (int) parameter.value_size, parameter.value);
+							}
+							break;
+						case webrunner_parameter_cache:
+							options.cache_mode = parse_cache_mode(parameter.value_size, parameter.value);
+							if (options.cache_mode == cache_mode_invalid) {
+								log_fatal("invalid cache mode %.*s\n", (int) parameter.value_size, parameter.value);
+							}
+							break;
+						case webrunner_parameter_warmup:
+							if (!parse_uint64(parameter.value_size, parameter.value, &options.warmup_iterations) ||
+								options.warmup_iterations > MAX_WARMUP_ITERATIONS)
+							{
+								log_fatal("invalid warmup iterations %.*s\n", (int) parameter.value_size, parameter.value);
+							}
+							break;
+						case webrunner_parameter_max_drift:
+							if (!parse_double(parameter.value_size, parameter.value, &options.max_drift) ||
+								!(options.max_drift >= 0.0))
+							{
+								log_fatal("invalid frequency drift %.*s\n", (int) parameter.value_size, parameter.value);
+							}
+							break;
+						case webrunner_parameter_calls_per_sample:
+							if (!parse_uint64(parameter.value_size, parameter.value, &options.calls_per_sample) ||
+								options.calls_per_sample == 0 || options.calls_per_sample > MAX_CALLS_PER_SAMPLE)
+							{
+								log_fatal("invalid calls per sample %.*s\n", (int) parameter.value_size, parameter.value);
+							}
+							break;
+						case webrunner_parameter_fence:
+							options.fence = parse_fence_strategy(parameter.value_size, parameter.value);
+							if (options.fence == fence_strategy_invalid || !is_fence_strategy_supported(options.fence)) {
+								log_fatal("invalid or unsupported fence %.*s\n", (int) parameter.value_size, parameter.value);
+							}
+							options.fence_requested = true;
+							break;
+						case webrunner_parameter_threads:
+							if (!parse_uint64(parameter.value_size, parameter.value, &options.threads) ||
+								options.threads == 0 || options.threads > MAX_THREADS)
+							{
+								log_fatal("invalid thread count %.*s\n", (int) parameter.value_size, parameter.value);
+							}
+							if (options.threads > get_core_cpu_count()) {
+								log_fatal("thread count %.*s exceeds the %zu physical cores of one package\n",
+									(int) parameter.value_size, parameter.value, get_core_cpu_count());
+							}
+							break;
+						case webrunner_parameter_sweep:
+							options.sweep = parse_sweep_mode(parameter.value_size, parameter.value);
+							if (options.sweep == sweep_mode_invalid) {
+								log_fatal("invalid sweep mode %.*s\n", (int) parameter.value_size, parameter.value);
+							}
+							break;
+						case webrunner_parameter_latency:
+						{
+							uint64_t latency;
+							if (!parse_uint64(parameter.value_size, parameter.value, &latency) || latency > 1) {
+								log_fatal("invalid latency mode %.*s\n", (int) parameter.value_size, parameter.value);
+							}
+							options.latency = latency != 0;
+							break;
+						}
+						case webrunner_parameter_kernel:
+							log_fatal("parameter kernel specified more than once\n");
+						default:
+							kernel_specifications[kernel].parse_parameter(parameters,
+								parameter.name_size, parameter.name, parameter.value_size, parameter.value);
+							break;
+					}
 				}
 				query = parameter.next;
 			} while (query);
@@ -275,34 +1246,39 @@ void process_request(int connection_socket) {
 		}
 		const void *const request_end = &request_buffer[bytes_received];
 		const void* request_body = &request_buffer[request.headers_length];
-		generic_function function = load_kernel(request_body, request_end - request_body, kernel_specifications[kernel].name);
+		size_t code_size = 0;
+		generic_function function = load_kernel(request_body, request_end - request_body, kernel_specifications[kernel].name, &code_size);
 
 		switch (request.command) {
 			case webrunner_command_run:
-			{
-				const struct performance_counters performance_counters = init_performance_counters();
-
-				void* arguments = alloca(kernel_specifications[kernel].arguments_size);
-				kernel_specifications[kernel].create_arguments(arguments, parameters);
-
-				enable_sandbox(connection_socket);
-
-				http_respond_status(connection_socket, http_status_ok, "OK");
-
-				for (size_t i = 0; i < performance_counters.count; i++) {
-					ioctl(performance_counters.counters[i].file_descriptor, PERF_EVENT_IOC_ENABLE, 0);
-					unsigned long long count = kernel_specifications[kernel].profile(function, arguments,
-						performance_counters.counters[i].file_descriptor, 100);
-					ioctl(performance_counters.counters[i].file_descriptor, PERF_EVENT_IOC_DISABLE, 0);
-					if (count != ULLONG_MAX) {
-						dprintf(connection_socket, "%s: %llu\n", performance_counters.counters[i].name, count);
-					}
+				if (options.latency && !kernel_specifications[kernel].returns_value) {
+					log_fatal("latency mode requires a kernel which returns a value\n");
+				}
+				switch (options.profile_mode) {
+					case webrunner_profile_mode_count:
+						if (options.sweep == sweep_mode_cache) {
+							if (options.threads > 1) {
+								log_fatal("the cache sweep supports only one thread\n");
+							}
+							run_cache_sweep(connection_socket, kernel, function, parameters, &options);
+						} else if (options.threads > 1) {
+							run_parallel(connection_socket, kernel, function, parameters, &options);
+						} else {
+							run_counting(connection_socket, kernel, function, parameters, &options);
+						}
+						break;
+					case webrunner_profile_mode_sample:
+						if (options.threads > 1 || options.sweep != sweep_mode_none) {
+							log_fatal("parallel runs and sweeps support only the counting profile mode\n");
+						}
+						run_sampling(connection_socket, kernel, function, code_size, parameters, &options);
+						break;
+					case webrunner_profile_mode_invalid:
+						__builtin_unreachable();
 				}
-
-				kernel_specifications[kernel].free_arguments(arguments, parameters);
 				break;
-			}
 			case webrunner_command_monitor:
+			case webrunner_command_calibration:
 			case webrunner_command_invalid:
 				__builtin_unreachable();
 		}
@@ -1,8 +1,12 @@
 #include <stdlib.h>
+#include <stdbool.h>
+#include <limits.h>
 #include <string.h>
+#include <inttypes.h>
 
 #include <errno.h>
 #include <unistd.h>
+#include <poll.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/wait.h>
@@ -12,11 +16,39 @@
 #include <webserver/options.h>
 #include <webserver/logs.h>
 #include <webrunner.h>
+#include <runner/perfctr.h>
+#include <runner/timing.h>
+#include <runner/calibration.h>
+#include <runner/cache.h>
+#include <runner/roofline.h>
+#include <runner/threads.h>
 
 int main(int argc, char** argv) {
 	struct options options = parse_options(argc, argv);
 	setup_logs(options.error_log, options.access_log);
 
+	const struct performance_event_table* event_table = init_performance_event_table(options.events_directory);
+	log_info("using %s event table (%zu events)\n", event_table->name, event_table->count);
+	const uint64_t tsc_frequency = init_tsc_frequency();
+	log_info("TSC frequency: %"PRIu64" kHz\n", tsc_frequency / 1000);
+	init_cache_info();
+	log_info("last-level cache: %zu KiB%s\n", get_last_level_cache_size() / 1024,
+		is_clflushopt_supported() ? ", clflushopt" : "");
+	const struct x86_cache_info* cache_info = get_cache_info();
+	for (size_t i = 0; i < cache_info->count; i++) {
+		log_info("L%"PRIu32" data cache: %zu KiB\n", cache_info->levels[i].level, cache_info->levels[i].size / 1024);
+	}
+	const struct machine_peaks* machine_peaks = init_machine_peaks();
+	log_info("peak throughput per TSC tick: %.2lf single-precision FLOPs, %.2lf double-precision FLOPs (%s), %.2lf bytes from memory\n",
+		machine_peaks->flops_per_tick, machine_peaks->double_flops_per_tick, machine_peaks->isa, machine_peaks->bytes_per_tick);
+	for (size_t i = 0; i < cache_info->count; i++) {
+		log_info("L%"PRIu32" read bandwidth per TSC tick: %.2lf bytes\n",
+			cache_info->levels[i].level, machine_peaks->cache_bytes_per_tick[i]);
+	}
+	log_info("parallel measurements: %zu physical cores in one package\n", init_cpu_topology());
+	calibrate_measurement_overhead();
+	log_info("measurement fence: %s\n", get_fence_strategy_name(get_default_fence_strategy()));
+
 	int server_socket = socket(PF_INET, SOCK_STREAM, IPPROTO_TCP);
 	if (server_socket == -1) {
 		log_fatal("failed to create socket: %s\n", strerror(errno));
@@ -39,7 +71,35 @@ int main(int argc, char** argv) {
 		log_fatal("failed to listen on socket: %s\n", strerror(errno));
 	}
 
+	/* A request was served since the last calibration */
+	bool served = false;
 	while (1) {
+		/*
+		 * Re-calibrate only while no client waits, so that the calibration neither delays a request nor competes with a
+		 * kernel for the CPU: an idle server re-calibrates when the calibration gets stale, a busy one in the first gap
+		 * between requests after that.
+		 */
+		const time_t calibration_age = time(NULL) - get_calibration_time();
+		int timeout_ms = -1;
+		if (calibration_age < (time_t) options.calibration_interval) {
+			const int64_t remaining_ms = ((int64_t) options.calibration_interval - (int64_t) calibration_age) * 1000;
+			timeout_ms = remaining_ms < INT_MAX ? (int) remaining_ms : INT_MAX;
+		} else if (served) {
+			timeout_ms = 0;
+		}
+		struct pollfd listener = { .fd = server_socket, .events = POLLIN };
+		const int ready = poll(&listener, 1, timeout_ms);
+		if (ready == 0) {
+			calibrate_measurement_overhead();
+			served = false;
+			continue;
+		} else if (ready == -1) {
+			if (errno != EINTR) {
+				log_fatal("failed to wait for connections: %s\n", strerror(errno));
+			}
+			continue;
+		}
+
 		struct sockaddr_in client_address;
 		unsigned int client_address_size = sizeof(client_address);
 
@@ -68,6 +128,7 @@ int main(int argc, char** argv) {
 				close(client_socket);
 				int status = 0;
 				waitpid(fork_process, &status, 0);
+				served = true;
 			}
 		}
 	}
@@ -29,6 +29,8 @@ def generate_source(source_filename, kernels):
 #include <runner/spec.h>""", file=source)
         for kernel in kernels:
             print("#include <{header}>".format(header=kernel.header), file=source)
+        for header in sorted(set(kernel.reference.header for kernel in kernels if kernel.reference is not None)):
+            print("#include <{header}>".format(header=header), file=source)
 
         print("""
 enum webrunner_kernel parse_kernel_name(size_t name_size, const char name[restrict static name_size]) {
@@ -62,10 +64,37 @@ const struct kernel_specification kernel_specifications[] = {""", file=source)
         .arguments_size = sizeof(struct {prefix}_arguments),
         .parameters_default = &{prefix}_parameters_default,
         .parse_parameter = (generic_parse_parameter_function) {prefix}_parse_parameter,
+        .get_arena_size = (generic_get_arena_size_function) {prefix}_get_arena_size,
+        .arena_alignment = {arena_alignment},
         .create_arguments = (generic_create_arguments_function) {prefix}_create_arguments,
         .free_arguments = (generic_free_arguments_function) {prefix}_free_arguments,
+        .get_argument_regions = (generic_get_argument_regions_function) {prefix}_get_argument_regions,
+        .argument_region_count = {region_count},
+        .returns_value = {returns_value},
+        .get_work = (generic_get_work_function) {prefix}_get_work,
+        .get_working_set_size = (generic_get_working_set_size_function) {prefix}_get_working_set_size,
+        .set_sweep_parameter = {set_sweep_parameter},
+        .sweep_parameter_name = {sweep_parameter_name},
         .profile = (generic_profile_function) {prefix}_profile,
-    }},""".format(name=kernel.name, prefix=kernel.prefix), file=source)
+        .sample = (generic_sample_function) {prefix}_sample,
+        .time = (generic_time_function) {prefix}_time,
+        .reference = {reference},
+        .reference_name = {reference_name},
+        .reference_profile = {reference_profile},
+        .reference_time = {reference_time},
+    }},""".format(name=kernel.name, prefix=kernel.prefix,
+                region_count=kernel.region_count, arena_alignment=kernel.arena_alignment,
+                set_sweep_parameter="(generic_set_sweep_parameter_function) " + kernel.prefix + "_set_sweep_parameter"
+                    if kernel.sweep is not None else "NULL",
+                sweep_parameter_name="\"" + kernel.sweep.name + "\"" if kernel.sweep is not None else "NULL",
+                returns_value="false" if kernel.return_type.is_void else "true",
+                reference="(generic_function) " + kernel.reference.function if kernel.reference is not None else "NULL",
+                reference_name="\"{function} ({name})\"".format(function=kernel.reference.function, name=kernel.reference.name)
+                    if kernel.reference is not None else "NULL",
+                reference_profile="(generic_profile_function) " + kernel.prefix + "_reference_profile"
+                    if kernel.reference is not None else "NULL",
+                reference_time="(generic_time_function) " + kernel.prefix + "_reference_time"
+                    if kernel.reference is not None else "NULL"), file=source)
 
         print("};", file=source)
 
@@ -75,6 +104,8 @@ def generate_header(header_filename, kernels):
 #pragma once
 
 #include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
 
 enum webrunner_kernel {
     webrunner_kernel_invalid = 0,""", file=header)
@@ -88,9 +119,28 @@ enum webrunner_kernel parse_kernel_name(size_t name_size, const char name[restri
 
 typedef void (*generic_function)(void);
 typedef void (*generic_parse_parameter_function)(void*, size_t, const char*, size_t, const char*);
-typedef void (*generic_create_arguments_function)(void*, const void*);
+typedef size_t (*generic_get_arena_size_function)(const void*);
+typedef void (*generic_create_arguments_function)(void*, const void*, void*);
 typedef void (*generic_free_arguments_function)(void*, const void*);
-typedef unsigned long long (*generic_profile_function)(generic_function, const void*, int, size_t);
+struct memory_region;
+typedef size_t (*generic_get_argument_regions_function)(const void*, const void*, struct memory_region*);
+struct kernel_work;
+typedef void (*generic_get_work_function)(const void*, struct kernel_work*);
+typedef uint64_t (*generic_get_working_set_size_function)(const void*);
+typedef void (*generic_set_sweep_parameter_function)(void*, uint64_t);
+struct performance_counter_group;
+struct sampling_counter;
+struct sample_histogram;
+struct timing_backend;
+struct timing_counts;
+struct sampling_policy;
+struct cache_policy;
+struct disturbance_counters;
+struct sample_accumulator;
+struct measurement_statistics;
+typedef bool (*generic_profile_function)(generic_function, const void*, const struct cache_policy*, const struct performance_counter_group*, const struct disturbance_counters*, const unsigned long long*, const struct sampling_policy*, struct sample_accumulator*, unsigned long long*, struct measurement_statistics*);
+typedef void (*generic_sample_function)(generic_function, const void*, const struct sampling_counter*, size_t, struct sample_histogram*);
+typedef bool (*generic_time_function)(generic_function, const void*, const struct cache_policy*, const struct timing_backend*, const struct disturbance_counters*, const struct timing_counts*, const struct sampling_policy*, struct sample_accumulator*, struct timing_counts*, struct measurement_statistics*);
 
 struct kernel_specification {
     const char* name;
@@ -98,9 +148,33 @@ struct kernel_specification {
     size_t arguments_size;
     void* parameters_default;
     generic_parse_parameter_function parse_parameter;
+    /* Size of the memory for the buffers of one argument copy, including alignment padding */
+    generic_get_arena_size_function get_arena_size;
+    /* Alignment of the memory for the buffers of one argument copy */
+    size_t arena_alignment;
+    /* Lays out the buffers in the given memory, or in an own arena if the memory is NULL */
     generic_create_arguments_function create_arguments;
     generic_free_arguments_function free_arguments;
+    generic_get_argument_regions_function get_argument_regions;
+    /* Number of memory regions get_argument_regions returns */
+    size_t argument_region_count;
+    /* The kernel returns a value which the latency mode can chain calls through */
+    bool returns_value;
+    generic_get_work_function get_work;
+    /* Total size of the argument buffers, in bytes */
+    generic_get_working_set_size_function get_working_set_size;
+    /* Sets the parameter which scales the working set in the cache sweep mode, or NULL if the kernel has none */
+    generic_set_sweep_parameter_function set_sweep_parameter;
+    const char* sweep_parameter_name;
     generic_profile_function profile;
+    generic_sample_function sample;
+    generic_time_function time;
+    /* Implementation compiled into the server which submitted kernels are compared against, or NULL */
+    generic_function reference;
+    const char* reference_name;
+    /* Measure the reference, which may take some query parameters before the kernel arguments */
+    generic_profile_function reference_profile;
+    generic_time_function reference_time;
 };
 
 extern const struct kernel_specification kernel_specifications[];""", file=header)
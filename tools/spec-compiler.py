@@ -20,6 +20,179 @@ parser.add_argument(
     help="Input XML specification file")
 
 
+def generate_arena_layout(kernel):
+    lines = []
+    if kernel.buffer_arguments:
+        lines.append(" " * 4 + "/* Lay out all buffers in one mapping */")
+        lines.append(" " * 4 + "size_t arena_size = 0;")
+    for argument in kernel.buffer_arguments:
+        lines.append(" " * 4 + "const size_t {name}_base = align_buffer_offset(arena_size, {alignment});".format(
+            name=argument.name, alignment=argument.buffer.alignment))
+        lines.append(" " * 4 + "const size_t {name}_offset = {name}_base + {offset};".format(
+            name=argument.name, offset=argument.buffer.offset.c_code("parameters->")))
+        lines.append(" " * 4 + "arena_size = {name}_offset + {size};".format(
+            name=argument.name, size=argument.size.c_code("parameters->")))
+    return lines
+
+
+def generate_argument_functions(kernel):
+    buffer_arguments = kernel.buffer_arguments
+    lines = ["""\
+size_t {kernel_prefix}_get_arena_size(
+    const struct {kernel_prefix}_parameters parameters[restrict static 1])
+{{""".format(kernel_prefix=kernel.prefix)]
+    if buffer_arguments:
+        lines += generate_arena_layout(kernel)
+        lines.append(" " * 4 + "return arena_size;")
+    else:
+        lines.append(" " * 4 + "return 0;")
+    lines.append("""\
+}}
+
+void {kernel_prefix}_create_arguments(
+    struct {kernel_prefix}_arguments arguments[restrict static 1],
+    const struct {kernel_prefix}_parameters parameters[restrict static 1],
+    void* memory)
+{{""".format(kernel_prefix=kernel.prefix))
+    lines += generate_arena_layout(kernel)
+    if buffer_arguments:
+        lines.append("""\
+    char* arena = memory;
+    if (arena == NULL) {
+        arena = allocate_argument_arena(arena_size);
+        arguments->arena = arena;
+    } else {
+        /* The caller owns the memory, which may hold the buffers of an earlier call */
+        memset(arena, 0, arena_size);
+        arguments->arena = NULL;
+    }
+    arguments->arena_size = arena_size;""")
+    else:
+        lines.append("""\
+    arguments->arena = NULL;
+    arguments->arena_size = 0;""")
+    for argument in kernel.arguments:
+        if argument.buffer is not None:
+            lines.append(" " * 4 + "arguments->{name} = ({type}) (arena + {name}_offset);".format(
+                name=argument.name, type=argument.c_type))
+        elif argument.view is not None:
+            lines.append(" " * 4 + "arguments->{name} = ({type}) (arena + {owner}_base + {offset});".format(
+                name=argument.name, type=argument.c_type, owner=argument.view.owner,
+                offset=argument.view.offset.c_code("parameters->")))
+        else:
+            lines.append(" " * 4 + "arguments->{name} = ({type}) {value};".format(
+                name=argument.name, type=argument.c_type, value=argument.value))
+    if kernel.reference is not None:
+        for parameter in kernel.reference.parameters:
+            lines.append(" " * 4 + "arguments->reference_{name} = parameters->{name};".format(name=parameter.name))
+    for index, argument in enumerate(buffer_arguments, start=1):
+        buffer = argument.buffer
+        fill_args = "({type}*) arguments->{name}, {count} * {stride}".format(
+            type=buffer.fill_c_type, name=argument.name,
+            count=buffer.count.c_code("parameters->"), stride=buffer.stride.c_code("parameters->"))
+        if buffer.init in ["uniform", "normal", "denormal", "sparse", "string"]:
+            if buffer.seed is not None:
+                fill_args += ", " + buffer.seed.c_code("parameters->")
+            else:
+                fill_args += ", UINT64_C({index})".format(index=index)
+        if buffer.init == "sparse":
+            fill_args += ", " + buffer.init_value
+        elif buffer.init == "constant":
+            fill_args += ", ({type}) {value}".format(type=buffer.fill_c_type, value=buffer.init_value[0])
+        elif buffer.init == "pattern":
+            fill_args += ", {size}, ({type}[]) {{ {values} }}".format(
+                size=len(buffer.init_value), type=buffer.fill_c_type, values=", ".join(buffer.init_value))
+
+        if buffer.init == "constant":
+            lines.append(" " * 4 + "fill_{type}_buffer({args});".format(type=buffer.fill_type, args=fill_args))
+        elif buffer.init == "pattern":
+            lines.append(" " * 4 + "fill_{type}_pattern_buffer({args});".format(type=buffer.fill_type, args=fill_args))
+        elif buffer.init != "zero":
+            lines.append(" " * 4 + "fill_{init}_{type}_buffer({args});".format(
+                init=buffer.init, type=buffer.fill_type, args=fill_args))
+    lines.append("""\
+}}
+
+void {kernel_prefix}_free_arguments(
+    struct {kernel_prefix}_arguments arguments[restrict static 1],
+    const struct {kernel_prefix}_parameters parameters[restrict static 1])
+{{
+    free_argument_arena(arguments->arena, arguments->arena_size);
+    arguments->arena = NULL;
+}}
+""".format(kernel_prefix=kernel.prefix))
+    return "\n".join(lines)
+
+
+def get_call_variants(kernel):
+    """Returns the suffixes of the generated call, profile, and time functions: the kernel's and its reference's"""
+    return ["", "_reference"] if kernel.reference is not None else [""]
+
+
+def get_leading_parameters(kernel, variant):
+    """Returns the query parameters which the called function takes before the kernel arguments"""
+    return kernel.reference.parameters if variant == "_reference" else []
+
+
+def generate_call_block(kernel, variant):
+    return """\
+static inline void {kernel_prefix}{variant}_call_block(void* function,
+    const struct {kernel_prefix}_arguments arguments[restrict static 1], size_t calls)
+{{
+    /* Unroll by 4 to keep the loop overhead small relative to the calls */
+    for (; calls >= 4; calls -= 4) {{
+        {kernel_prefix}{variant}_call(function, arguments);
+        {kernel_prefix}{variant}_call(function, arguments);
+        {kernel_prefix}{variant}_call(function, arguments);
+        {kernel_prefix}{variant}_call(function, arguments);
+    }}
+    for (; calls != 0; calls--) {{
+        {kernel_prefix}{variant}_call(function, arguments);
+    }}
+}}
+""".format(kernel_prefix=kernel.prefix, variant=variant)
+
+
+def generate_call_chain(kernel, variant):
+    if kernel.return_type.is_void:
+        return """\
+/* The kernel returns no result to chain calls through */
+static inline void {kernel_prefix}{variant}_call_chain(void* function,
+    const struct {kernel_prefix}_arguments arguments[restrict static 1], size_t calls)
+{{
+    {kernel_prefix}{variant}_call_block(function, arguments, calls);
+}}
+""".format(kernel_prefix=kernel.prefix, variant=variant)
+
+    # Floating-point arguments are passed unchanged: integer and pointer arguments carry the dependency
+    leading_parameters = get_leading_parameters(kernel, variant)
+    dependent_args = ["arguments->reference_" + parameter.name for parameter in leading_parameters]
+    for argument in kernel.arguments:
+        if argument.is_floating_point:
+            dependent_args.append("arguments->" + argument.name)
+        else:
+            dependent_args.append("({type}) ((uintptr_t) arguments->{name} + dependency)".format(
+                type=argument.c_type, name=argument.name))
+    return """\
+static inline void {kernel_prefix}{variant}_call_chain(void* function,
+    const struct {kernel_prefix}_arguments arguments[restrict static 1], size_t calls)
+{{
+    typedef {return_type} (*{kernel_name}_function)({kernel_argtypes});
+    {kernel_name}_function {kernel_name} = ({kernel_name}_function) function;
+    uintptr_t dependency = 0;
+    for (; calls != 0; calls--) {{
+        const {return_type} result = {kernel_name}({kernel_dependent_args});
+        dependency = {dependency_function}(result);
+    }}
+}}
+""".format(kernel_prefix=kernel.prefix, variant=variant, kernel_name=kernel.name,
+        return_type=kernel.return_type.c_type,
+        kernel_argtypes=", ".join([parameter.c_type for parameter in leading_parameters] +
+            [argument.c_type for argument in kernel.arguments]),
+        kernel_dependent_args=", ".join(dependent_args),
+        dependency_function=kernel.return_type.dependency_function)
+
+
 def generate_source(source_filename, kernel):
     with open(source_filename, "w") as source:
         print("""\
@@ -28,6 +201,7 @@ def generate_source(source_filename, kernel):
 #include <webserver/parse.h>
 #include <webserver/logs.h>
 #include <runner/benchmark.h>
+#include <runner/arguments.h>
 #include <{kernel_header}>
 
 struct {kernel_prefix}_parameters {kernel_prefix}_parameters_default = {{""".format(
@@ -82,9 +256,83 @@ void {kernel_prefix}_parse_parameter(
     log_fatal("invalid parameter %.*s for {kernel_full_name}\\n", (int) name_size, name);
 }}
 
-DEFINE_PROFILE_FUNCTION({kernel_prefix})""".format(
-                kernel_full_name=kernel.full_name, kernel_prefix=kernel.prefix),
+size_t {kernel_prefix}_get_argument_regions(
+    const struct {kernel_prefix}_arguments arguments[restrict static 1],
+    const struct {kernel_prefix}_parameters parameters[restrict static 1],
+    struct memory_region regions[restrict static {region_count}])
+{{""".format(kernel_full_name=kernel.full_name, kernel_prefix=kernel.prefix, region_count=max(kernel.region_count, 1)),
+            file=source)
+        sized_arguments = [argument for argument in kernel.arguments if argument.size is not None]
+        for i, argument in enumerate(sized_arguments):
+            print(" " * 4 + "regions[{index}] = (struct memory_region) {{ .address = arguments->{name}, .size = {size} }};".format(
+                    index=i, name=argument.name, size=argument.size.c_code("parameters->")),
+                file=source)
+        print("""\
+    return {count};
+}}
+
+void {kernel_prefix}_get_work(
+    const struct {kernel_prefix}_parameters parameters[restrict static 1],
+    struct kernel_work work[restrict static 1])
+{{""".format(kernel_prefix=kernel.prefix, count=len(sized_arguments)), file=source)
+        for attribute in ["flops", "bytes", "elements"]:
+            expression = getattr(kernel, attribute)
+            print(" " * 4 + "work->{name} = {value};".format(
+                    name=attribute, value=expression.c_code("parameters->") if expression is not None else "0"),
+                file=source)
+        print(" " * 4 + "work->double_precision = {value};".format(
+                value="true" if kernel.precision == "double" else "false"),
             file=source)
+        print("""\
+}}
+
+uint64_t {kernel_prefix}_get_working_set_size(
+    const struct {kernel_prefix}_parameters parameters[restrict static 1])
+{{
+    return {size};
+}}""".format(kernel_prefix=kernel.prefix,
+                size=" + ".join(argument.size.c_code("parameters->") for argument in kernel.buffer_arguments) or "0"),
+            file=source)
+        if kernel.sweep is not None:
+            print("""
+void {kernel_prefix}_set_sweep_parameter(
+    struct {kernel_prefix}_parameters parameters[restrict static 1],
+    uint64_t value)
+{{""".format(kernel_prefix=kernel.prefix), file=source)
+            # Clamp the value to the valid range of the parameter
+            if kernel.sweep.min is not None:
+                print(" " * 4 + "if (value < {min}) {{\n        value = {min};\n    }}".format(min=kernel.sweep.c_min), file=source)
+            print(" " * 4 + "if (value > {max}) {{\n        value = {max};\n    }}".format(
+                    max=kernel.sweep.c_max if kernel.sweep.max is not None else Parameter.c_max_values[kernel.sweep.type]),
+                file=source)
+            print(" " * 4 + "parameters->{name} = ({type}) value;\n}}".format(name=kernel.sweep.name, type=kernel.sweep.c_type),
+                file=source)
+        print("""
+{argument_functions}""".format(argument_functions=generate_argument_functions(kernel)), file=source)
+        for variant in get_call_variants(kernel):
+            print("""\
+{call_block}
+{call_chain}
+DEFINE_PROFILE_FUNCTION({kernel_prefix}, {variant})
+
+DEFINE_TIME_FUNCTION({kernel_prefix}, {variant})
+""".format(kernel_prefix=kernel.prefix, variant=variant, call_block=generate_call_block(kernel, variant),
+                    call_chain=generate_call_chain(kernel, variant)),
+                file=source)
+        print("DEFINE_SAMPLE_FUNCTION({kernel_prefix})".format(kernel_prefix=kernel.prefix), file=source)
+
+
+def generate_call_statement(kernel, variant):
+    call = "{kernel_name}({kernel_args})".format(kernel_name=kernel.name,
+        kernel_args=", ".join(["arguments->reference_" + parameter.name for parameter in get_leading_parameters(kernel, variant)] +
+            ["arguments->" + argument.name for argument in kernel.arguments]))
+    if kernel.return_type.is_void:
+        return " " * 4 + call + ";"
+    # Sink the result into a register so that the compiler keeps the computation of the returned value
+    return """\
+    const {return_type} result = {call};
+    __asm__ __volatile__ ("" :: "{constraint}" (result));""".format(
+        return_type=kernel.return_type.c_type, call=call, constraint=kernel.return_type.constraint)
 
 
 def generate_header(header_filename, kernel):
@@ -94,6 +342,15 @@ def generate_header(header_filename, kernel):
 
 #include <stddef.h>
 #include <stdint.h>
+#include <stdbool.h>
+
+#include <runner/perfctr.h>
+#include <runner/sampling.h>
+#include <runner/timing.h>
+#include <runner/statistics.h>
+#include <runner/disturbance.h>
+#include <runner/cache.h>
+#include <runner/roofline.h>
 
 struct {kernel_prefix}_parameters {{""".format(kernel_prefix=kernel.prefix), file=header)
         for parameter in kernel.parameters:
@@ -106,36 +363,89 @@ extern struct {kernel_prefix}_parameters {kernel_prefix}_parameters_default;
 struct {kernel_prefix}_arguments {{""".format(kernel_prefix=kernel.prefix), file=header)
         for argument in kernel.arguments:
             print(" " * 4 + "{type} {name};".format(name=argument.name, type=argument.c_type), file=header)
+        if kernel.reference is not None and kernel.reference.parameters:
+            print(" " * 4 + "/* Parameters which the reference implementation takes before the kernel arguments */", file=header)
+            for parameter in kernel.reference.parameters:
+                print(" " * 4 + "{type} reference_{name};".format(name=parameter.name, type=parameter.c_type), file=header)
         print("""\
+    /* Mapping which holds all buffers of the arguments */
+    void* arena;
+    size_t arena_size;
 }};
-
-static inline void {kernel_prefix}_call(void* function,
+""".format(kernel_prefix=kernel.prefix), file=header)
+        for variant in get_call_variants(kernel):
+            print("""\
+static inline void {kernel_prefix}{variant}_call(void* function,
     const struct {kernel_prefix}_arguments arguments[restrict static 1])
 {{
-    typedef float (*{kernel_name}_function)({kernel_argtypes});
+    typedef {return_type} (*{kernel_name}_function)({kernel_argtypes});
     {kernel_name}_function {kernel_name} = ({kernel_name}_function) function;
-    {kernel_name}({kernel_args});
+{call_statement}
 }}
 
-unsigned long long {kernel_prefix}_profile(void* function,
+bool {kernel_prefix}{variant}_profile(void* function,
+    const struct {kernel_prefix}_arguments arguments[restrict static 1],
+    const struct cache_policy cache[restrict static 1],
+    const struct performance_counter_group group[restrict static 1],
+    const struct disturbance_counters disturbance[restrict static 1],
+    const unsigned long long overhead[restrict static 1],
+    const struct sampling_policy policy[restrict static 1],
+    struct sample_accumulator accumulators[restrict static 1],
+    unsigned long long counts[restrict static 1],
+    struct measurement_statistics statistics[restrict static 1]);
+
+bool {kernel_prefix}{variant}_time(void* function,
+    const struct {kernel_prefix}_arguments arguments[restrict static 1],
+    const struct cache_policy cache[restrict static 1],
+    const struct timing_backend backend[restrict static 1],
+    const struct disturbance_counters disturbance[restrict static 1],
+    const struct timing_counts overhead[restrict static 1],
+    const struct sampling_policy policy[restrict static 1],
+    struct sample_accumulator accumulators[restrict static timing_quantity_count],
+    struct timing_counts counts[restrict static 1],
+    struct measurement_statistics statistics[restrict static 1]);
+""".format(kernel_name=kernel.name, kernel_prefix=kernel.prefix, variant=variant,
+                    return_type=kernel.return_type.c_type,
+                    kernel_argtypes=", ".join([parameter.c_type for parameter in get_leading_parameters(kernel, variant)] +
+                        [argument.c_type for argument in kernel.arguments]),
+                    call_statement=generate_call_statement(kernel, variant)),
+                file=header)
+        print("""\
+void {kernel_prefix}_sample(void* function,
     const struct {kernel_prefix}_arguments arguments[restrict static 1],
-    int perf_counter_fd, size_t max_iterations);
+    const struct sampling_counter counter[restrict static 1], size_t iterations,
+    struct sample_histogram histogram[restrict static 1]);
 
 void {kernel_prefix}_parse_parameter(
     struct {kernel_prefix}_parameters parameters[restrict static 1],
     size_t name_size, const char name[restrict static name_size],
     size_t value_size, const char value[restrict static value_size]);
+size_t {kernel_prefix}_get_arena_size(
+    const struct {kernel_prefix}_parameters parameters[restrict static 1]);
 void {kernel_prefix}_create_arguments(
     struct {kernel_prefix}_arguments[restrict static 1],
-    const struct {kernel_prefix}_parameters parameters[restrict static 1]);
+    const struct {kernel_prefix}_parameters parameters[restrict static 1],
+    void* memory);
 void {kernel_prefix}_free_arguments(
     struct {kernel_prefix}_arguments[restrict static 1],
     const struct {kernel_prefix}_parameters parameters[restrict static 1]);
-
-""".format(kernel_name=kernel.name, kernel_prefix=kernel.prefix,
-                kernel_argtypes=", ".join(argument.c_type for argument in kernel.arguments),
-                kernel_args=", ".join("arguments->" + argument.name for argument in kernel.arguments)),
+size_t {kernel_prefix}_get_argument_regions(
+    const struct {kernel_prefix}_arguments arguments[restrict static 1],
+    const struct {kernel_prefix}_parameters parameters[restrict static 1],
+    struct memory_region regions[restrict static {region_count}]);
+void {kernel_prefix}_get_work(
+    const struct {kernel_prefix}_parameters parameters[restrict static 1],
+    struct kernel_work work[restrict static 1]);
+uint64_t {kernel_prefix}_get_working_set_size(
+    const struct {kernel_prefix}_parameters parameters[restrict static 1]);
+""".format(kernel_prefix=kernel.prefix, region_count=max(kernel.region_count, 1)),
             file=header)
+        if kernel.sweep is not None:
+            print("""\
+void {kernel_prefix}_set_sweep_parameter(
+    struct {kernel_prefix}_parameters parameters[restrict static 1],
+    uint64_t value);
+""".format(kernel_prefix=kernel.prefix), file=header)
 
 
 
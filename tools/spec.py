@@ -1,4 +1,5 @@
 from __future__ import absolute_import
+import ast
 import xml.etree.ElementTree as ET
 
 
@@ -8,6 +9,17 @@ class Kernel:
         self.namespace = namespace
         self.parameters = []
         self.arguments = []
+        self.return_type = ReturnType("void")
+        # Implementation compiled into the server which a submitted kernel is compared against, or None
+        self.reference = None
+        # Integer parameter which scales the working set in the cache sweep mode, or None
+        self.sweep = None
+        # Expressions for the work and memory traffic of a kernel call
+        self.flops = None
+        self.bytes = None
+        self.elements = None
+        # Precision of the floating-point operations, which selects the compute peak of the roofline
+        self.precision = "single"
 
     @property
     def full_name(self):
@@ -23,6 +35,21 @@ class Kernel:
         else:
             return self.name
 
+    @property
+    def region_count(self):
+        """Number of pointer arguments with a known size"""
+        return sum(1 for argument in self.arguments if argument.size is not None)
+
+    @property
+    def buffer_arguments(self):
+        """Pointer arguments which own a buffer, i.e. the memory the kernel may touch without double-counting views"""
+        return [argument for argument in self.arguments if argument.buffer is not None]
+
+    @property
+    def arena_alignment(self):
+        """Alignment of the memory for the argument buffers: the largest buffer alignment, and at least a cache line"""
+        return max([64] + [argument.buffer.alignment for argument in self.buffer_arguments])
+
     @property
     def header(self):
         if self.namespace is not None:
@@ -32,8 +59,24 @@ class Kernel:
 
 
 class Parameter:
+    c_types = {
+        "uint32": "uint32_t",
+        "uint64": "uint64_t",
+        "int32": "int32_t",
+        "int64": "int64_t",
+        "float": "float",
+        "double": "double",
+    }
+
+    c_max_values = {
+        "uint32": "UINT32_MAX",
+        "uint64": "UINT64_MAX",
+        "int32": "INT32_MAX",
+        "int64": "INT64_MAX",
+    }
+
     def __init__(self, name, type, default):
-        assert type in ["uint32", "uint64"]
+        assert type in Parameter.c_types
 
         self.name = name
         self.type = type
@@ -43,45 +86,253 @@ class Parameter:
 
     @property
     def c_type(self):
-        return {
-            "uint32": "uint32_t",
-            "uint64": "uint64_t"
-        }[self.type]
+        return Parameter.c_types[self.type]
+
+    @property
+    def is_integer(self):
+        return self.type not in ["float", "double"]
+
+    @property
+    def is_unsigned(self):
+        return self.type in ["uint32", "uint64"]
+
+    def c_literal(self, value):
+        """Returns C code for a constant of the parameter type"""
+        if self.is_integer:
+            return self.type.upper() + "_C(" + value + ")"
+        else:
+            return "(" + self.c_type + ") " + value
 
     @property
     def c_default(self):
-        return {
-            "uint32": "UINT32_C(",
-            "uint64": "UINT64_C("
-        }[self.type] + self.default + ")"
+        return self.c_literal(self.default)
 
     @property
     def c_min(self):
         if self.min is not None:
-            return {
-                "uint32": "UINT32_C(",
-                "uint64": "UINT64_C("
-            }[self.type] + self.min + ")"
+            return self.c_literal(self.min)
 
     @property
     def c_max(self):
         if self.max is not None:
-            return {
-                "uint32": "UINT32_C(",
-                "uint64": "UINT64_C("
-            }[self.type] + self.max + ")"
+            return self.c_literal(self.max)
+
+
+class Expression:
+    """Integer expression over kernel parameters, e.g. ``n * incx * 4``"""
+
+    operators = {
+        ast.Add: "+",
+        ast.Sub: "-",
+        ast.Mult: "*",
+        ast.Div: "/",
+        ast.FloorDiv: "/",
+    }
+
+    def __init__(self, text, parameters):
+        self.text = text
+        # Parameters are converted to uint64_t, so signed ones may only appear if their minimum rules out negative values
+        self.parameter_names = set(parameter.name for parameter in parameters
+            if parameter.is_integer and (parameter.is_unsigned or parameter.min is not None and int(parameter.min) >= 0))
+        self.tree = ast.parse(text.strip(), mode="eval").body
+        self.c_code("parameters->")
+
+    def c_code(self, prefix):
+        """Returns C code for the expression, with parameter names prefixed with ``prefix``"""
+        return self._c_code(self.tree, prefix)
+
+    def _c_code(self, node, prefix):
+        if isinstance(node, ast.BinOp) and type(node.op) in Expression.operators:
+            return "(" + self._c_code(node.left, prefix) + " " + Expression.operators[type(node.op)] + " " + \
+                self._c_code(node.right, prefix) + ")"
+        elif isinstance(node, ast.Name) and node.id in self.parameter_names:
+            return "((uint64_t) " + prefix + node.id + ")"
+        number = getattr(node, "value", getattr(node, "n", None))
+        if isinstance(node, getattr(ast, "Constant", getattr(ast, "Num", None))) and isinstance(number, int) \
+                and not isinstance(number, bool) and number >= 0:
+            return "UINT64_C(" + str(number) + ")"
+        raise ValueError("unsupported element in expression %s: %s" % (self.text, ast.dump(node)))
 
 
 class Argument:
     def __init__(self, name, c_type):
-        assert c_type in ["size_t",
+        assert c_type in ["size_t", "ptrdiff_t", "int",
             "uint8_t", "uint16_t", "uint32_t", "uint64_t",
             "int8_t", "int16_t", "int32_t", "int64_t",
+            "float", "double",
             "const float*", "float*",
-            "const double*", "double*"]
+            "const double*", "double*",
+            "const uint8_t*", "uint8_t*",
+            "const char*", "char*",
+            "const void*", "void*"]
 
         self.name = name
         self.c_type = c_type
+        # C code for the value of a scalar argument, in terms of kernel parameters
+        self.value = None
+        # Buffer which a pointer argument points to
+        self.buffer = None
+        # Part of the buffer of another argument which a pointer argument points to
+        self.view = None
+
+    @property
+    def is_pointer(self):
+        return self.c_type.endswith("*")
+
+    @property
+    def element_type(self):
+        """C type of the elements a pointer argument points to"""
+        return self.c_type.replace("const ", "").rstrip("*")
+
+    @property
+    def size(self):
+        """Expression for the number of bytes the kernel may access through a pointer argument, or None"""
+        if self.buffer is not None:
+            return self.buffer.size
+        elif self.view is not None:
+            return self.view.size
+
+    @property
+    def is_floating_point(self):
+        return self.c_type in ["float", "double"]
+
+
+class Buffer:
+    """Memory which a pointer argument points to, allocated from the arena of a kernel call"""
+
+    element_sizes = {
+        "float": 4,
+        "double": 8,
+        "uint8_t": 1,
+        "char": 1,
+        "void": 1,
+    }
+
+    # Suffix of the functions which fill buffers of each element type
+    fill_types = {
+        "float": "float",
+        "double": "double",
+        "uint8_t": "uint8",
+        "char": "uint8",
+        "void": "uint8",
+    }
+
+    # Initialization policies besides "sparse:<density>" and constants
+    floating_point_policies = ["zero", "uniform", "normal", "denormal", "sequence"]
+    byte_policies = ["zero", "uniform", "sequence", "string"]
+
+    def __init__(self, element_type, parameters, count, stride="1", alignment="64", offset="0", init="zero", seed=None):
+        assert element_type in Buffer.element_sizes
+
+        self.element_type = element_type
+        # Number of elements, each followed by stride - 1 unused elements
+        self.count = Expression(count, parameters)
+        self.stride = Expression(stride, parameters)
+        self.alignment = int(alignment)
+        assert self.alignment > 0 and self.alignment & (self.alignment - 1) == 0 and self.alignment <= 4096
+        # Offset in bytes of the buffer start from the aligned address, e.g. to test misaligned data
+        self.offset = Expression(offset, parameters)
+        # One of the policies, "sparse", "constant", or "pattern"
+        self.init = init
+        # Probability of non-zero elements for the "sparse" policy, or the values for "constant" and "pattern"
+        self.init_value = None
+        policies = Buffer.byte_policies if self.element_size == 1 else Buffer.floating_point_policies
+        if init.startswith("sparse:") and self.element_size != 1:
+            self.init = "sparse"
+            self.init_value = init[len("sparse:"):]
+            assert 0.0 <= float(self.init_value) <= 1.0
+        elif init not in policies:
+            # A constant, or a comma-separated list of constants repeated over the buffer, e.g. "1.0, 0.0"
+            self.init_value = [value.strip() for value in init.split(",")]
+            for value in self.init_value:
+                if self.element_size == 1:
+                    assert 0 <= int(value, 0) <= 255
+                else:
+                    float(value)
+            self.init = "constant" if len(self.init_value) == 1 else "pattern"
+        # Expression for the seed of pseudo-random policies, or None to derive it from the buffer position
+        self.seed = Expression(seed, parameters) if seed is not None else None
+        self.size = Expression("(%s) * (%s) * %d" % (count, stride, self.element_size), parameters)
+
+    @property
+    def element_size(self):
+        return Buffer.element_sizes[self.element_type]
+
+    @property
+    def fill_type(self):
+        return Buffer.fill_types[self.element_type]
+
+    @property
+    def fill_c_type(self):
+        return {"uint8": "uint8_t"}.get(self.fill_type, self.fill_type)
+
+
+class View:
+    """Part of the buffer of another pointer argument, e.g. for overlapping source and destination"""
+
+    def __init__(self, element_type, parameters, of, count, stride="1", offset="0"):
+        assert element_type in Buffer.element_sizes
+
+        # Name of the argument which owns the buffer
+        self.owner = of
+        # Offset in bytes from the aligned start of the owner buffer, before the owner's own offset
+        self.offset = Expression(offset, parameters)
+        self.size = Expression("(%s) * (%s) * %d" % (count, stride, Buffer.element_sizes[element_type]), parameters)
+
+
+class ReturnType:
+    """Type of the value a kernel returns"""
+
+    # Inline assembly constraint of a register which can hold a value of each type
+    constraints = {
+        "float": "x",
+        "double": "x",
+        "int32_t": "r",
+        "int64_t": "r",
+        "uint32_t": "r",
+        "uint64_t": "r",
+        "size_t": "r",
+        "int": "r",
+    }
+
+    def __init__(self, c_type):
+        assert c_type == "void" or c_type in ReturnType.constraints
+
+        self.c_type = c_type
+
+    @property
+    def is_void(self):
+        return self.c_type == "void"
+
+    @property
+    def constraint(self):
+        return ReturnType.constraints[self.c_type]
+
+    @property
+    def dependency_function(self):
+        """Name of the function which derives a data dependency from a returned value"""
+        return {
+            "float": "get_float_result_dependency",
+            "double": "get_double_result_dependency",
+        }.get(self.c_type, "get_integer_result_dependency")
+
+
+class Reference:
+    """Implementation compiled into the server, which submitted kernels are compared against"""
+
+    def __init__(self, function, header, name, kernel_parameters, parameters=""):
+        # C function with the signature of the kernel, preceded by the values of the listed parameters
+        self.function = function
+        # Header which declares the function
+        self.header = header
+        # Human-readable description of the implementation, e.g. "glibc"
+        self.name = name
+        # Query parameters passed to the function before the kernel arguments, e.g. the tile size of a microkernel
+        self.parameters = []
+        for parameter_name in parameters.split():
+            matches = [parameter for parameter in kernel_parameters if parameter.name == parameter_name]
+            assert len(matches) == 1, "unknown reference parameter " + parameter_name
+            self.parameters.append(matches[0])
 
 
 def read_kernel_specification(xml_filename):
@@ -95,7 +346,7 @@ def read_kernel_specification(xml_filename):
     kernel = Kernel(xml_kernel.attrib["name"], xml_kernel.attrib.get("namespace"))
 
     for xml_element in xml_kernel:
-        assert xml_element.tag in ["query", "call"]
+        assert xml_element.tag in ["query", "call", "work", "reference", "sweep"]
         if xml_element.tag == "query":
             for xml_parameter in xml_element:
                 assert xml_parameter.tag == "parameter"
@@ -104,8 +355,40 @@ def read_kernel_specification(xml_filename):
                 parameter.max = xml_parameter.get("max")
                 kernel.parameters.append(parameter)
         elif xml_element.tag == "call":
+            kernel.return_type = ReturnType(xml_element.get("return", "void"))
             for xml_argument in xml_element:
                 assert xml_argument.tag == "argument"
                 argument = Argument(xml_argument.attrib["name"], xml_argument.attrib["type"])
+                if argument.is_pointer:
+                    xml_buffers = list(xml_argument)
+                    assert len(xml_buffers) == 1 and xml_buffers[0].tag in ["buffer", "view"]
+                    if xml_buffers[0].tag == "buffer":
+                        argument.buffer = Buffer(argument.element_type, kernel.parameters, **xml_buffers[0].attrib)
+                    else:
+                        argument.view = View(argument.element_type, kernel.parameters, **xml_buffers[0].attrib)
+                else:
+                    value = xml_argument.attrib["value"]
+                    if value in [parameter.name for parameter in kernel.parameters]:
+                        argument.value = "parameters->" + value
+                    else:
+                        argument.value = Expression(value, kernel.parameters).c_code("parameters->")
                 kernel.arguments.append(argument)
+        elif xml_element.tag == "reference":
+            kernel.reference = Reference(kernel_parameters=kernel.parameters, **xml_element.attrib)
+        elif xml_element.tag == "sweep":
+            kernel.sweep = xml_element.attrib["parameter"]
+        elif xml_element.tag == "work":
+            for attribute in ["flops", "bytes", "elements"]:
+                if attribute in xml_element.attrib:
+                    setattr(kernel, attribute, Expression(xml_element.attrib[attribute], kernel.parameters))
+            kernel.precision = xml_element.get("precision", "single")
+            assert kernel.precision in ["single", "double"]
+    for argument in kernel.arguments:
+        if argument.view is not None:
+            owners = [owner for owner in kernel.arguments if owner.name == argument.view.owner]
+            assert len(owners) == 1 and owners[0].buffer is not None
+    if kernel.sweep is not None:
+        sweep_parameters = [parameter for parameter in kernel.parameters if parameter.name == kernel.sweep]
+        assert len(sweep_parameters) == 1 and sweep_parameters[0].is_integer
+        kernel.sweep = sweep_parameters[0]
     return kernel